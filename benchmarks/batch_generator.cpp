@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+constexpr size_t element_count = 1'000'000;
+
+
+/*********
+ * SETUP *
+ *********/
+static generator<float, false> float_range(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        co_yield static_cast<float>(i & 1023);
+    }
+}
+
+template<size_t batch_size>
+static batch_generator<float, batch_size, false> float_batches(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        co_yield static_cast<float>(i & 1023);
+    }
+}
+
+
+/* Computes each batch in a plain loop and yields it as a span, the producer side vectorises too */
+template<size_t batch_size>
+static batch_generator<float, batch_size, false> float_spans(size_t count) {
+    std::array<float, batch_size> chunk{};
+    for (size_t i = 0; i < count; i += batch_size) {
+        size_t size = std::min(batch_size, count - i);
+        for (size_t j = 0; j < size; ++j) {
+            chunk[j] = static_cast<float>((i + j) & 1023);
+        }
+        co_yield std::span<const float>(chunk.data(), size);
+    }
+}
+
+
+/**
+ * Benchmarks
+ */
+void generator_accumulate(benchmark::State &state) {
+    float acc = 0;
+    for (auto _: state) {
+        auto gen = float_range(element_count);
+        acc = std::accumulate(gen.begin(), gen.end(), 0.f);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+/* One resume per batch, but still one element at a time on the consumer side */
+template<size_t batch_size>
+void batch_iterator_accumulate(benchmark::State &state) {
+    float acc = 0;
+    for (auto _: state) {
+        acc = 0;
+        for (float v: float_batches<batch_size>(element_count)) {
+            acc += v;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+template<size_t batch_size>
+void batch_span_sum(benchmark::State &state) {
+    float acc = 0;
+    for (auto _: state) {
+        auto gen = float_batches<batch_size>(element_count);
+        acc = batch_sum(gen);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+template<size_t batch_size>
+void batch_span_producer_sum(benchmark::State &state) {
+    float acc = 0;
+    for (auto _: state) {
+        auto gen = float_spans<batch_size>(element_count);
+        acc = batch_sum(gen);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+template<size_t batch_size>
+void batch_span_max(benchmark::State &state) {
+    float acc = 0;
+    for (auto _: state) {
+        auto gen = float_batches<batch_size>(element_count);
+        acc = *batch_max(gen);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+BENCHMARK(generator_accumulate)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_iterator_accumulate, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_iterator_accumulate, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_sum, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_sum, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_sum, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_producer_sum, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_producer_sum, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_producer_sum, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_max, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(batch_span_max, 1024)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ * Messages per second through a channel<uint64_t>: producer and consumer tasks on a single thread, then 1:1, N:1
+ * and N:M producer and consumer threads, each running one task.
+ */
+
+static constexpr uint64_t message_count = 1 << 20;
+
+/*********
+ * SETUP *
+ *********/
+static single_task<void, false> produce(channel<uint64_t> &ch, uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_await ch.send(i);
+    }
+}
+
+static single_task<void, false> consume(channel<uint64_t> &ch, uint64_t &sum) {
+    while (auto value = co_await ch.recv()) {
+        sum += *value;
+    }
+}
+
+/* Started right away: they suspend on the channel and resume each other */
+static single_task<> produce_and_close(channel<uint64_t> &ch, uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_await ch.send(i);
+    }
+    ch.close();
+}
+
+static single_task<> consume_inline(channel<uint64_t> &ch, uint64_t &sum) {
+    while (auto value = co_await ch.recv()) {
+        sum += *value;
+    }
+}
+
+
+/**
+ * One thread: each time the ring fills, the producer suspends and the consumer drains it
+ */
+void single_thread(benchmark::State &state) {
+    uint64_t sum = 0;
+    for (auto _: state) {
+        auto ch = channel<uint64_t>(static_cast<size_t>(state.range(0)));
+        auto consumer = consume_inline(ch, sum);
+        auto producer = produce_and_close(ch, message_count);
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * message_count));
+}
+
+/**
+ * range(0) producer threads and range(1) consumer threads, through 1024 slots
+ */
+void threads(benchmark::State &state) {
+    auto producer_count = static_cast<size_t>(state.range(0));
+    auto consumer_count = static_cast<size_t>(state.range(1));
+    std::vector<uint64_t> sums(consumer_count * 8); // One cache line each
+    for (auto _: state) {
+        auto ch = channel<uint64_t>(1024);
+        std::vector<std::thread> consumers, producers;
+        for (size_t i = 0; i < consumer_count; ++i) {
+            consumers.emplace_back([&, i]() { sync_wait(consume(ch, sums[i * 8])); });
+        }
+        for (size_t i = 0; i < producer_count; ++i) {
+            producers.emplace_back([&]() { sync_wait(produce(ch, message_count / producer_count)); });
+        }
+        for (auto &producer: producers) producer.join();
+        ch.close();
+        for (auto &consumer: consumers) consumer.join();
+    }
+    benchmark::DoNotOptimize(sums.data());
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * message_count));
+}
+
+BENCHMARK(single_thread)->Arg(2)->Arg(64)->Arg(1024)->Unit(benchmark::kMillisecond);
+BENCHMARK(threads)->Args({1, 1})->Args({4, 1})->Args({4, 4})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <stdexcept>
+
+constexpr size_t batch_size = 1'000;
+
+
+/*********
+ * SETUP *
+ *********/
+static single_task<uint32_t, true, true> checked_with_exceptions(uint32_t value, bool fail) {
+    if (fail) throw std::runtime_error("Invalid input"s);
+    co_return value + 1;
+}
+
+static single_task<expected<uint32_t, std::errc>> checked_with_expected(uint32_t value, bool fail) {
+    if (fail) co_return unexpected(std::errc::invalid_argument);
+    co_return value + 1;
+}
+
+
+/**
+ * Benchmarks: creates, runs and reads back tasks that all fail, or all succeed
+ */
+template<bool fail>
+void exceptions_policy(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (uint32_t i = 0; i < batch_size; ++i) {
+            auto task = checked_with_exceptions(i, fail);
+            try {
+                acc += *task.get();
+            } catch (const std::exception &) {
+                ++acc;
+            }
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch_size));
+}
+
+template<bool fail>
+void expected_policy(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (uint32_t i = 0; i < batch_size; ++i) {
+            auto task = checked_with_expected(i, fail);
+            auto result = *task.get();
+            acc += result ? *result : 1;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch_size));
+}
+
+BENCHMARK_TEMPLATE(exceptions_policy, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(expected_policy, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(exceptions_policy, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(expected_policy, false)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
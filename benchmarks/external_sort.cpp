@@ -0,0 +1,134 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * Sorts 256 MiB of random 64 bits integers with a memory budget of a tenth of that, through runs spilled to
+ * CORO_SORT_BENCH_DIR, against std::sort of the whole data in memory. CORO_SORT_BENCH_BYTES sets the size.
+ * Then merges k sorted vectors with the loser tree of merge() and with a binary heap.
+ */
+
+/*********
+ * SETUP *
+ *********/
+static size_t data_bytes() {
+    auto *bytes = std::getenv("CORO_SORT_BENCH_BYTES");
+    return bytes ? std::strtoull(bytes, nullptr, 10) : (size_t{256} << 20);
+}
+
+static std::filesystem::path temp_dir() {
+    auto *dir = std::getenv("CORO_SORT_BENCH_DIR");
+    return dir ? std::filesystem::path(dir) : std::filesystem::temp_directory_path();
+}
+
+static generator<uint64_t> random_values(size_t count) {
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i < count; ++i) {
+        co_yield rng();
+    }
+}
+
+static std::vector<std::vector<uint64_t>> sorted_sources(size_t k, size_t total) {
+    std::mt19937_64 rng(42);
+    std::vector<std::vector<uint64_t>> sources(k);
+    for (size_t i = 0; i < total; ++i) {
+        sources[rng() % k].push_back(rng());
+    }
+    for (auto &source: sources) {
+        std::sort(source.begin(), source.end());
+    }
+    return sources;
+}
+
+
+/**
+ * Whole data in memory: the lower bound, with ten times the budget
+ */
+void in_memory_sort(benchmark::State &state) {
+    size_t count = data_bytes() / sizeof(uint64_t);
+    uint64_t checksum = 0;
+    for (auto _: state) {
+        std::vector<uint64_t> values;
+        values.reserve(count);
+        for (auto value: random_values(count)) {
+            values.push_back(value);
+        }
+        std::sort(values.begin(), values.end());
+        for (auto value: values) {
+            checksum = checksum * 31 + value;
+        }
+    }
+    benchmark::DoNotOptimize(checksum);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(uint64_t)));
+}
+
+/**
+ * Ten sorted runs written to disk, read back and merged
+ */
+void external_sort_tenth(benchmark::State &state) {
+    size_t count = data_bytes() / sizeof(uint64_t);
+    uint64_t checksum = 0;
+    for (auto _: state) {
+        for (auto value: external_sort(random_values(count), data_bytes() / 10, std::less<>{}, temp_dir())) {
+            checksum = checksum * 31 + value;
+        }
+    }
+    benchmark::DoNotOptimize(checksum);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(uint64_t)));
+}
+
+/**
+ * k-way merge of 4M values, log2(k) comparisons per value
+ */
+void loser_tree_merge(benchmark::State &state) {
+    auto sources = sorted_sources(static_cast<size_t>(state.range(0)), size_t{1} << 22);
+    uint64_t checksum = 0;
+    for (auto _: state) {
+        for (auto value: merge(std::span(sources))) {
+            checksum += value;
+        }
+    }
+    benchmark::DoNotOptimize(checksum);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (size_t{1} << 22)));
+}
+
+/**
+ * Same merge through std::priority_queue, up to 2 log2(k) comparisons per value
+ */
+void binary_heap_merge(benchmark::State &state) {
+    auto sources = sorted_sources(static_cast<size_t>(state.range(0)), size_t{1} << 22);
+    uint64_t checksum = 0;
+    for (auto _: state) {
+        using entry = std::pair<uint64_t, size_t>;
+        std::priority_queue<entry, std::vector<entry>, std::greater<>> heap;
+        std::vector<size_t> positions(sources.size());
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (!sources[i].empty()) heap.emplace(sources[i][0], i);
+        }
+        while (!heap.empty()) {
+            auto [value, i] = heap.top();
+            heap.pop();
+            checksum += value;
+            if (++positions[i] < sources[i].size()) heap.emplace(sources[i][positions[i]], i);
+        }
+    }
+    benchmark::DoNotOptimize(checksum);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (size_t{1} << 22)));
+}
+
+BENCHMARK(in_memory_sort)->Unit(benchmark::kMillisecond);
+BENCHMARK(external_sort_tenth)->Unit(benchmark::kMillisecond);
+BENCHMARK(loser_tree_merge)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMillisecond);
+BENCHMARK(binary_heap_merge)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Reads a multi-GB file, 2 GiB by default: CORO_IO_BENCH_BYTES sets the size and CORO_IO_BENCH_DIR where it is
+ * created. Buffered reads mostly come from the page cache once the file has been written, the O_DIRECT ones go to
+ * the device every time.
+ */
+constexpr size_t block_size = 128 * 1024;
+constexpr size_t coroutine_count = 64;
+
+
+/*********
+ * SETUP *
+ *********/
+class bench_file {
+public:
+    static bench_file &get() {
+        static bench_file file;
+        return file;
+    }
+
+    [[nodiscard]] int fd(bool direct) const noexcept { return direct ? direct_fd_ : fd_; }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    ~bench_file() {
+        if (direct_fd_ >= 0) close(direct_fd_);
+        close(fd_);
+        unlink(path_.c_str());
+    }
+
+private:
+    bench_file() {
+        auto *bytes = std::getenv("CORO_IO_BENCH_BYTES");
+        size_ = bytes ? std::strtoull(bytes, nullptr, 10) : (size_t{2} << 30);
+        size_ = std::max(size_ / block_size, size_t{1}) * block_size;
+        auto *dir = std::getenv("CORO_IO_BENCH_DIR");
+        path_ = std::string(dir ? dir : "/tmp") + "/coro_io_benchXXXXXX";
+        fd_ = mkstemp(path_.data());
+        std::vector<char> chunk(8 << 20, 'x');
+        for (size_t offset = 0; offset < size_; offset += chunk.size()) {
+            auto count = std::min(chunk.size(), size_ - offset);
+            if (::pwrite(fd_, chunk.data(), count, static_cast<off_t>(offset)) != static_cast<ssize_t>(count)) {
+                throw std::runtime_error("Could not write the benchmark file");
+            }
+        }
+        fsync(fd_);
+        direct_fd_ = open(path_.c_str(), O_RDONLY | O_DIRECT);
+    }
+
+    int fd_ = -1;
+    int direct_fd_ = -1;
+    size_t size_ = 0;
+    std::string path_;
+};
+
+/* O_DIRECT wants buffers aligned on the logical block size of the device */
+static auto aligned_buffer(size_t size) {
+    return std::unique_ptr<std::byte, decltype(&std::free)>(static_cast<std::byte *>(std::aligned_alloc(4096, size)), &std::free);
+}
+
+static single_task<size_t, true, true> read_stride(io_ring &ring, int fd, size_t first, size_t size) {
+    auto buffer = aligned_buffer(block_size);
+    size_t total = 0;
+    for (size_t offset = first * block_size; offset < size; offset += coroutine_count * block_size) {
+        total += co_await async_read(ring, fd, std::span(buffer.get(), block_size), offset);
+    }
+    co_return total;
+}
+
+
+/**
+ * One thread, one blocking pread after the other
+ */
+void blocking_reads(benchmark::State &state) {
+    auto &file = bench_file::get();
+    bool direct = state.range(0);
+    if (file.fd(direct) < 0) {
+        state.SkipWithError("O_DIRECT is not supported here");
+        return;
+    }
+    auto buffer = aligned_buffer(block_size);
+    size_t total = 0;
+    for (auto _: state) {
+        for (size_t offset = 0; offset < file.size(); offset += block_size) {
+            total += static_cast<size_t>(::pread(file.fd(direct), buffer.get(), block_size, static_cast<off_t>(offset)));
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+
+/**
+ * 64 coroutines on one thread, each reading every 64th block, with up to 64 reads in flight.
+ * The blocking backend runs the same coroutines over pread: the cost of the coroutines alone.
+ */
+template<io_backend backend>
+void coroutine_reads(benchmark::State &state) {
+    auto &file = bench_file::get();
+    bool direct = state.range(0);
+    auto ring = io_ring(coroutine_count, backend);
+    if (file.fd(direct) < 0 || ring.backend() != backend) {
+        state.SkipWithError(file.fd(direct) < 0 ? "O_DIRECT is not supported here" : "io_uring is not available");
+        return;
+    }
+    size_t total = 0;
+    for (auto _: state) {
+        std::vector<single_task<size_t, true, true>> readers;
+        readers.reserve(coroutine_count);
+        for (size_t i = 0; i < coroutine_count; ++i) {
+            readers.push_back(read_stride(ring, file.fd(direct), i, file.size()));
+        }
+        ring.run();
+        for (auto &reader: readers) {
+            total += *reader.get();
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+    state.counters["enter_calls"] = benchmark::Counter(static_cast<double>(ring.enter_calls()), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(blocking_reads)->ArgName("direct")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(coroutine_reads, io_backend::io_uring)->ArgName("direct")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(coroutine_reads, io_backend::blocking)->ArgName("direct")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
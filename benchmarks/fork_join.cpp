@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <thread>
+#include <vector>
+
+constexpr int fib_n = 32;
+constexpr int serial_cutoff = 16;
+
+
+/*********
+ * SETUP *
+ *********/
+static uint64_t serial_fib(int n) {
+    return n < 2 ? static_cast<uint64_t>(n) : serial_fib(n - 1) + serial_fib(n - 2);
+}
+
+/**
+ * Each level forks its two children onto the pool, they get stolen by idle workers.
+ */
+static single_task<uint64_t> parallel_fib(thread_pool &pool, int n) {
+    co_await pool.schedule();
+    if (n < serial_cutoff) co_return serial_fib(n);
+    auto a = parallel_fib(pool, n - 1);
+    auto b = parallel_fib(pool, n - 2);
+    auto fib_b = co_await b; // The most recently forked is the first popped by this worker
+    co_return co_await a + fib_b;
+}
+
+/**
+ * Same fork, joined through when_all: both children link to one countdown, the last one to complete resumes the parent
+ */
+static single_task<uint64_t> when_all_fib(thread_pool &pool, int n) {
+    co_await pool.schedule();
+    if (n < serial_cutoff) co_return serial_fib(n);
+    auto [a, b] = co_await when_all(when_all_fib(pool, n - 1), when_all_fib(pool, n - 2));
+    co_return a + b;
+}
+
+static single_task<uint64_t, false> leaf(uint64_t value) {
+    co_return value;
+}
+
+/**
+ * Fan-out of lazy tasks completing inline: the cost of the group itself against awaiting the tasks one by one
+ */
+static single_task<uint64_t> fan_out_when_all(size_t width) {
+    std::vector<single_task<uint64_t, false>> tasks;
+    tasks.reserve(width);
+    for (size_t i = 0; i < width; ++i) {
+        tasks.push_back(leaf(i));
+    }
+    uint64_t sum = 0;
+    for (auto value: co_await when_all(std::move(tasks))) {
+        sum += value;
+    }
+    co_return sum;
+}
+
+static single_task<uint64_t> fan_out_sequential(size_t width) {
+    std::vector<single_task<uint64_t, false>> tasks;
+    tasks.reserve(width);
+    for (size_t i = 0; i < width; ++i) {
+        tasks.push_back(leaf(i));
+    }
+    uint64_t sum = 0;
+    for (auto &task: tasks) {
+        sum += co_await std::move(task);
+    }
+    co_return sum;
+}
+
+
+void fib_serial(benchmark::State &state) {
+    uint64_t result = 0;
+    for (auto _: state) {
+        result = serial_fib(fib_n);
+    }
+    state.SetLabel(std::to_string(result));
+}
+
+void fib_fork_join(benchmark::State &state) {
+    auto pool = thread_pool(static_cast<size_t>(state.range(0)));
+    uint64_t result = 0;
+    for (auto _: state) {
+        result = sync_wait(parallel_fib(pool, fib_n));
+    }
+    state.SetLabel(std::to_string(result));
+}
+
+void fib_when_all(benchmark::State &state) {
+    auto pool = thread_pool(static_cast<size_t>(state.range(0)));
+    uint64_t result = 0;
+    for (auto _: state) {
+        result = sync_wait(when_all_fib(pool, fib_n));
+    }
+    state.SetLabel(std::to_string(result));
+}
+
+template<single_task<uint64_t> (*fan_out)(size_t)>
+void fan_out_inline(benchmark::State &state) {
+    auto width = static_cast<size_t>(state.range(0));
+    uint64_t result = 0;
+    for (auto _: state) {
+        result += *fan_out(width).get();
+    }
+    benchmark::DoNotOptimize(result);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * width));
+}
+
+BENCHMARK(fib_serial)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(fib_fork_join)->Unit(benchmark::kMillisecond)->UseRealTime()->RangeMultiplier(2)->Range(1, static_cast<int>(std::max(1U, std::thread::hardware_concurrency())));
+BENCHMARK(fib_when_all)->Unit(benchmark::kMillisecond)->UseRealTime()->RangeMultiplier(2)->Range(1, static_cast<int>(std::max(1U, std::thread::hardware_concurrency())));
+BENCHMARK_TEMPLATE(fan_out_inline, fan_out_when_all)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(fan_out_inline, fan_out_sequential)->Arg(16)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <array>
+
+constexpr size_t batch_size = 1'000;
+
+
+/*********
+ * SETUP *
+ *********/
+template<typename frame_policy>
+static single_task<size_t, true, false, frame_policy> short_lived_task(size_t value) {
+    co_await std::suspend_always{};
+    co_return value + 1;
+}
+
+template<typename frame_policy>
+static generator<size_t, false, frame_policy> short_range(size_t end) {
+    for (size_t i = 0; i < end; ++i) {
+        co_yield i;
+    }
+}
+
+
+/**
+ * Creates and destroys one task at a time, the frame goes back to the allocator right away.
+ */
+template<typename frame_policy>
+void task_create_destroy(benchmark::State &state) {
+    size_t acc = 0;
+    for (auto _: state) {
+        auto task = short_lived_task<frame_policy>(acc);
+        acc = *task();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+
+/**
+ * Keeps a batch of tasks alive before destroying them all, like an interleaving scheduler would.
+ */
+template<typename frame_policy>
+void task_batch_create_destroy(benchmark::State &state) {
+    size_t acc = 0;
+    auto tasks = std::array<single_task<size_t, true, false, frame_policy>, batch_size>{};
+    for (auto _: state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            tasks[i] = short_lived_task<frame_policy>(i);
+        }
+        for (auto &task: tasks) {
+            acc += *task();
+            task.destroy();
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch_size));
+}
+
+
+template<typename frame_policy>
+void generator_create_destroy(benchmark::State &state) {
+    size_t acc = 0;
+    for (auto _: state) {
+        for (auto i: short_range<frame_policy>(4)) {
+            acc += i;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK_TEMPLATE(task_create_destroy, heap_frames);
+BENCHMARK_TEMPLATE(task_create_destroy, pooled_frames);
+BENCHMARK_TEMPLATE(task_batch_create_destroy, heap_frames);
+BENCHMARK_TEMPLATE(task_batch_create_destroy, pooled_frames);
+BENCHMARK_TEMPLATE(generator_create_destroy, heap_frames);
+BENCHMARK_TEMPLATE(generator_create_destroy, pooled_frames);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <ranges>
+
+constexpr uint64_t element_count = 1'000'000;
+
+
+/*********
+ * SETUP *
+ *********/
+static generator<uint64_t, false> iota(uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+static constexpr auto square = [](uint64_t i) { return i * i + 1; };
+static constexpr auto not_multiple_of_3 = [](uint64_t i) { return i % 3 != 0; };
+
+/**
+ * One generator per stage, each one resumes the previous one for every element
+ */
+template<typename F>
+static generator<uint64_t, false> transform_stage(generator<uint64_t, false> source, F f) {
+    for (auto i: source) {
+        co_yield f(i);
+    }
+}
+
+template<typename Pred>
+static generator<uint64_t, false> filter_stage(generator<uint64_t, false> source, Pred pred) {
+    for (auto i: source) {
+        if (pred(i)) co_yield i;
+    }
+}
+
+static generator<uint64_t, false> take_stage(generator<uint64_t, false> source, uint64_t count) {
+    if (count == 0) co_return;
+    for (auto i: source) {
+        co_yield i;
+        if (--count == 0) co_return;
+    }
+}
+
+
+/**
+ * Benchmarks: source -> transform -> filter -> take
+ */
+void stacked_generators(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: take_stage(filter_stage(transform_stage(iota(element_count), square), not_multiple_of_3), element_count / 2)) {
+            acc += i;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+void standard_views(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: iota(element_count) | std::views::transform(square) | std::views::filter(not_multiple_of_3) | std::views::take(element_count / 2)) {
+            acc += i;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+void fused_views(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: iota(element_count) | fused::transform(square) | fused::filter(not_multiple_of_3) | fused::take(element_count / 2)) {
+            acc += i;
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * element_count));
+}
+
+BENCHMARK(stacked_generators)->Unit(benchmark::kMicrosecond);
+BENCHMARK(standard_views)->Unit(benchmark::kMicrosecond);
+BENCHMARK(fused_views)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
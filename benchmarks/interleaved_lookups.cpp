@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+
+#include "perf_counters.hpp"
+
+#include <coro>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+constexpr size_t lookup_count = 1U << 16;
+constexpr size_t interleave_width = 16;
+
+
+/*********
+ * SETUP *
+ *********/
+static std::vector<uint64_t> random_keys(size_t count, unsigned seed) {
+    std::mt19937_64 engine(seed);
+    std::vector<uint64_t> out(count);
+    std::generate(out.begin(), out.end(), [&]() { return engine(); });
+    return out;
+}
+
+static std::vector<uint64_t> sorted_keys(size_t count) {
+    auto keys = random_keys(count, 0);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+/* Half of the lookups hit */
+static std::vector<uint64_t> lookup_keys(const std::vector<uint64_t> &present) {
+    auto keys = random_keys(lookup_count, 1);
+    std::mt19937_64 engine(2);
+    std::uniform_int_distribution<size_t> pick(0, present.size() - 1);
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        keys[i] = present[pick(engine)];
+    }
+    return keys;
+}
+
+template<typename F>
+static void run_lookups(benchmark::State &state, F &&lookup_all) {
+    auto counters = perf_counter_scope(state);
+    for (auto _: state) {
+        auto results = lookup_all();
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lookup_count));
+}
+
+
+/**
+ * Binary search in a sorted array
+ */
+void std_lower_bound(benchmark::State &state) {
+    auto sorted = sorted_keys(static_cast<size_t>(state.range(0)));
+    auto keys = lookup_keys(sorted);
+    run_lookups(state, [&]() {
+        std::vector<size_t> results;
+        results.reserve(keys.size());
+        for (auto key: keys) {
+            results.push_back(static_cast<size_t>(std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin()));
+        }
+        return results;
+    });
+}
+
+void branchless_lower_bound(benchmark::State &state) {
+    auto sorted = sorted_keys(static_cast<size_t>(state.range(0)));
+    auto keys = lookup_keys(sorted);
+    run_lookups(state, [&]() { return scalar_lower_bound(sorted, keys); });
+}
+
+void coro_lower_bound(benchmark::State &state) {
+    auto sorted = sorted_keys(static_cast<size_t>(state.range(0)));
+    auto keys = lookup_keys(sorted);
+    run_lookups(state, [&]() { return interleaved_lower_bound<interleave_width>(sorted, keys); });
+}
+
+
+/**
+ * Open addressing hash table
+ */
+static open_addressing_table<uint64_t, uint64_t> make_table(const std::vector<uint64_t> &keys) {
+    auto table = open_addressing_table<uint64_t, uint64_t>(keys.size());
+    for (auto key: keys) {
+        table.insert(key, ~key);
+    }
+    return table;
+}
+
+void scalar_hash_probe(benchmark::State &state) {
+    auto present = random_keys(static_cast<size_t>(state.range(0)), 0);
+    auto table = make_table(present);
+    auto keys = lookup_keys(present);
+    run_lookups(state, [&]() {
+        std::vector<const uint64_t *> results;
+        results.reserve(keys.size());
+        for (auto key: keys) {
+            results.push_back(table.find(key));
+        }
+        return results;
+    });
+}
+
+void coro_hash_probe(benchmark::State &state) {
+    auto present = random_keys(static_cast<size_t>(state.range(0)), 0);
+    auto table = make_table(present);
+    auto keys = lookup_keys(present);
+    run_lookups(state, [&]() { return interleaved_hash_probe<interleave_width>(table, keys); });
+}
+
+
+/**
+ * B+tree descent
+ */
+static bplus_tree<uint64_t, uint64_t> make_tree(const std::vector<uint64_t> &sorted) {
+    auto values = std::vector<uint64_t>(sorted.size());
+    std::transform(sorted.begin(), sorted.end(), values.begin(), [](uint64_t key) { return ~key; });
+    return {sorted, std::move(values)};
+}
+
+void scalar_tree_find(benchmark::State &state) {
+    auto sorted = sorted_keys(static_cast<size_t>(state.range(0)));
+    auto tree = make_tree(sorted);
+    auto keys = lookup_keys(sorted);
+    run_lookups(state, [&]() {
+        std::vector<const uint64_t *> results;
+        results.reserve(keys.size());
+        for (auto key: keys) {
+            results.push_back(tree.find(key));
+        }
+        return results;
+    });
+}
+
+void coro_tree_find(benchmark::State &state) {
+    auto sorted = sorted_keys(static_cast<size_t>(state.range(0)));
+    auto tree = make_tree(sorted);
+    auto keys = lookup_keys(sorted);
+    run_lookups(state, [&]() { return interleaved_tree_find<interleave_width>(tree, keys); });
+}
+
+/* From 8 MiB of keys, in cache, to 256 MiB, beyond the last level cache of most machines */
+BENCHMARK(std_lower_bound)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(branchless_lower_bound)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(coro_lower_bound)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(scalar_hash_probe)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(coro_hash_probe)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(scalar_tree_find)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+BENCHMARK(coro_tree_find)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1 << 20, 1 << 25);
+
+BENCHMARK_MAIN();
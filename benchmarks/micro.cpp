@@ -0,0 +1,289 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+
+constexpr uint64_t sequence_length = 10'000;
+
+
+/*********
+ * SETUP *
+ *********/
+template<bool start_immediately, bool propagate_exceptions>
+static single_task<uint64_t, start_immediately, propagate_exceptions> returns_at_once(uint64_t value) {
+    co_return value + 1;
+}
+
+static single_task<uint64_t, true, false, pooled_frames, traced> traced_returns_at_once(uint64_t value) {
+    co_return value + 1;
+}
+
+template<bool propagate_exceptions>
+static single_task<void, false, propagate_exceptions> suspends_forever() {
+    while (true) {
+        co_await std::suspend_always{};
+    }
+}
+
+template<bool propagate_exceptions>
+static generator<uint64_t, propagate_exceptions> iota(uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+template<bool propagate_exceptions>
+static async_generator<uint64_t, propagate_exceptions> async_iota(uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+template<bool propagate_exceptions>
+static single_task<uint64_t> sum_async(uint64_t count) {
+    auto gen = async_iota<propagate_exceptions>(count);
+    uint64_t acc = 0;
+    while (auto i = co_await gen.next()) {
+        acc += *i;
+        benchmark::DoNotOptimize(acc);
+    }
+    co_return acc;
+}
+
+static generator<uint64_t, false> endless() {
+    for (uint64_t i = 0;; ++i) {
+        co_yield i;
+    }
+}
+
+__attribute__((noinline)) static void for_each_callback(uint64_t count, const std::function<void(uint64_t)> &callback) {
+    for (uint64_t i = 0; i < count; ++i) {
+        callback(i);
+    }
+}
+
+template<typename F>
+static void for_each_inlined(uint64_t count, F &&callback) {
+    for (uint64_t i = 0; i < count; ++i) {
+        callback(i);
+    }
+}
+
+/* What the generator replaces: the state lives in the iterator */
+struct iota_range {
+    struct iterator {
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = uint64_t;
+
+        uint64_t current;
+
+        inline uint64_t operator*() const noexcept { return current; }
+
+        inline iterator &operator++() noexcept {
+            ++current;
+            return *this;
+        }
+
+        inline bool operator==(const iterator &) const noexcept = default;
+    };
+
+    uint64_t count;
+
+    [[nodiscard]] iterator begin() const noexcept { return {0}; }
+
+    [[nodiscard]] iterator end() const noexcept { return {count}; }
+};
+
+
+/**
+ * Frames: creation, run to completion and destruction, for each task configuration
+ */
+template<bool start_immediately, bool propagate_exceptions>
+void task_lifecycle(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        auto task = returns_at_once<start_immediately, propagate_exceptions>(acc);
+        acc = *task();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/* Cost of the instrumentation when enabled: creation, completion and destruction events */
+void traced_task_lifecycle(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        auto task = traced_returns_at_once(acc);
+        acc = *task();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<bool propagate_exceptions>
+void generator_lifecycle(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        auto gen = iota<propagate_exceptions>(1);
+        acc += *gen();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+
+/**
+ * Resume latency: a suspended coroutine resumed in a loop
+ */
+template<bool propagate_exceptions>
+void task_resume(benchmark::State &state) {
+    auto task = suspends_forever<propagate_exceptions>();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(task.resume());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void raw_handle_resume(benchmark::State &state) {
+    auto task = suspends_forever<false>();
+    auto handle = static_cast<std::coroutine_handle<>>(task);
+    for (auto _: state) {
+        handle.resume();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void generator_resume(benchmark::State &state) {
+    auto gen = endless();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(gen());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+
+/**
+ * Iterating over a sequence: generator against the alternatives
+ */
+template<bool propagate_exceptions>
+void iterate_generator(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: iota<propagate_exceptions>(sequence_length)) {
+            acc += i;
+            benchmark::DoNotOptimize(acc);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+/* Each value is a transfer to the producer and back, from a task */
+template<bool propagate_exceptions>
+void iterate_async_generator(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        acc += *sum_async<propagate_exceptions>(sequence_length).get();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+void iterate_plain_loop(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (uint64_t i = 0; i < sequence_length; ++i) {
+            acc += i;
+            benchmark::DoNotOptimize(acc);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+void iterate_std_function_callback(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for_each_callback(sequence_length, [&](uint64_t i) {
+            acc += i;
+            benchmark::DoNotOptimize(acc);
+        });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+void iterate_inlined_callback(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for_each_inlined(sequence_length, [&](uint64_t i) {
+            acc += i;
+            benchmark::DoNotOptimize(acc);
+        });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+void iterate_hand_written_iterator(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: iota_range{sequence_length}) {
+            acc += i;
+            benchmark::DoNotOptimize(acc);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * sequence_length));
+}
+
+
+/**
+ * get() on a completed task or a suspended generator: the exception check and the copy into an optional
+ */
+template<bool propagate_exceptions>
+void task_get(benchmark::State &state) {
+    auto task = returns_at_once<true, propagate_exceptions>(41);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(task.get());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<bool propagate_exceptions>
+void generator_get(benchmark::State &state) {
+    auto gen = iota<propagate_exceptions>(2);
+    gen();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(gen.get());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK_TEMPLATE(task_lifecycle, false, false);
+BENCHMARK_TEMPLATE(task_lifecycle, false, true);
+BENCHMARK_TEMPLATE(task_lifecycle, true, false);
+BENCHMARK_TEMPLATE(task_lifecycle, true, true);
+BENCHMARK(traced_task_lifecycle);
+BENCHMARK_TEMPLATE(generator_lifecycle, false);
+BENCHMARK_TEMPLATE(generator_lifecycle, true);
+
+BENCHMARK_TEMPLATE(task_resume, false);
+BENCHMARK_TEMPLATE(task_resume, true);
+BENCHMARK(raw_handle_resume);
+BENCHMARK(generator_resume);
+
+BENCHMARK_TEMPLATE(iterate_generator, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(iterate_generator, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(iterate_async_generator, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(iterate_async_generator, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK(iterate_plain_loop)->Unit(benchmark::kMicrosecond);
+BENCHMARK(iterate_std_function_callback)->Unit(benchmark::kMicrosecond);
+BENCHMARK(iterate_inlined_callback)->Unit(benchmark::kMicrosecond);
+BENCHMARK(iterate_hand_written_iterator)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(task_get, false);
+BENCHMARK_TEMPLATE(task_get, true);
+BENCHMARK_TEMPLATE(generator_get, false);
+BENCHMARK_TEMPLATE(generator_get, true);
+
+BENCHMARK_MAIN();
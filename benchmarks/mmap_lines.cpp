@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+
+/**
+ * Streams the lines of a 1 GiB log-like file, lines of 20 to 200 characters. CORO_MMAP_BENCH_BYTES sets the size
+ * and CORO_MMAP_BENCH_DIR where it is created. The file is written first, so the page cache holds it.
+ */
+
+/*********
+ * SETUP *
+ *********/
+class lines_file {
+public:
+    static lines_file &get() {
+        static lines_file file;
+        return file;
+    }
+
+    [[nodiscard]] const std::string &path() const noexcept { return path_; }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    ~lines_file() { unlink(path_.c_str()); }
+
+private:
+    lines_file() {
+        auto *bytes = std::getenv("CORO_MMAP_BENCH_BYTES");
+        auto target = bytes ? std::strtoull(bytes, nullptr, 10) : (size_t{1} << 30);
+        auto *dir = std::getenv("CORO_MMAP_BENCH_DIR");
+        path_ = std::string(dir ? dir : "/tmp") + "/coro_mmap_benchXXXXXX";
+        close(mkstemp(path_.data()));
+        std::ofstream out(path_, std::ios::binary);
+        std::mt19937_64 rng(42);
+        std::string line;
+        while (size_ < target) {
+            line.assign(20 + rng() % 181, 'a' + static_cast<char>(rng() % 26));
+            line += '\n';
+            out << line;
+            size_ += line.size();
+        }
+    }
+
+    std::string path_;
+    size_t size_ = 0;
+};
+
+
+/**
+ * Each line copied into a std::string
+ */
+void getline_lines(benchmark::State &state) {
+    auto &file = lines_file::get();
+    size_t total = 0;
+    for (auto _: state) {
+        std::ifstream in(file.path(), std::ios::binary);
+        for (std::string line; std::getline(in, line);) {
+            total += line.size();
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+
+/**
+ * Views into the mapping, delimiters found 64 bytes at a time
+ */
+void mmap_lines_generator(benchmark::State &state) {
+    auto &file = lines_file::get();
+    size_t total = 0;
+    for (auto _: state) {
+        for (auto line: mmap_lines(file.path())) {
+            total += line.size();
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+
+/**
+ * Hand-written loop over the mapping with memchr, no generator: the cost of the generator and of the scanner
+ */
+void mmap_memchr_loop(benchmark::State &state) {
+    auto &file = lines_file::get();
+    size_t total = 0;
+    for (auto _: state) {
+        auto mapping = mapped_file(file.path());
+        auto text = mapping.view();
+        const char *begin = text.data(), *end = text.data() + text.size();
+        while (begin != end) {
+            auto *found = static_cast<const char *>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            found = found ? found : end;
+            total += static_cast<size_t>(found - begin);
+            benchmark::DoNotOptimize(total);
+            begin = found == end ? end : found + 1;
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+
+BENCHMARK(getline_lines)->Unit(benchmark::kMillisecond);
+BENCHMARK(mmap_lines_generator)->Unit(benchmark::kMillisecond);
+BENCHMARK(mmap_memchr_loop)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
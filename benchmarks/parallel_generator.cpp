@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <thread>
+
+constexpr uint64_t item_count = 1U << 14;
+
+
+/*********
+ * SETUP *
+ *********/
+static generator<uint64_t> cheap_producer(uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+/* About a microsecond of dependent arithmetic per item */
+static inline uint64_t expensive_work(uint64_t value, uint64_t rounds) {
+    for (uint64_t r = 0; r < rounds; ++r) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 29;
+    }
+    return value;
+}
+
+static size_t max_threads() {
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+
+/**
+ * One thread draining the generator
+ */
+void serial_for_each(benchmark::State &state) {
+    auto rounds = static_cast<uint64_t>(state.range(0));
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (auto i: cheap_producer(item_count)) {
+            acc += expensive_work(i, rounds);
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * item_count));
+}
+
+/**
+ * The calling thread plus `threads - 1` workers
+ */
+void parallel_for_each(benchmark::State &state) {
+    auto rounds = static_cast<uint64_t>(state.range(0));
+    auto pool = thread_pool(static_cast<size_t>(state.range(1)) - 1);
+    std::atomic<uint64_t> acc{0};
+    for (auto _: state) {
+        parallel_for_each(cheap_producer(item_count), pool, [&](uint64_t i) { acc.fetch_add(expensive_work(i, rounds), std::memory_order_relaxed); });
+    }
+    benchmark::DoNotOptimize(acc.load());
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * item_count));
+    state.counters["threads"] = static_cast<double>(state.range(1));
+}
+
+void parallel_reduce(benchmark::State &state) {
+    auto rounds = static_cast<uint64_t>(state.range(0));
+    auto pool = thread_pool(static_cast<size_t>(state.range(1)) - 1);
+    uint64_t acc = 0;
+    for (auto _: state) {
+        acc += parallel_reduce(cheap_producer(item_count), pool, uint64_t{0}, [&](uint64_t a, uint64_t b) { return a + expensive_work(b, rounds); });
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * item_count));
+    state.counters["threads"] = static_cast<double>(state.range(1));
+}
+
+static void thread_counts(benchmark::internal::Benchmark *b) {
+    for (int64_t rounds: {10, 100, 1000}) {
+        for (int64_t threads = 1; threads <= static_cast<int64_t>(max_threads()); threads *= 2) {
+            b->Args({rounds, threads});
+        }
+        if (max_threads() & (max_threads() - 1)) {
+            b->Args({rounds, static_cast<int64_t>(max_threads())});
+        }
+    }
+}
+
+BENCHMARK(serial_for_each)->Unit(benchmark::kMillisecond)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(parallel_for_each)->Unit(benchmark::kMillisecond)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(parallel_reduce)->Unit(benchmark::kMillisecond)->Apply(thread_counts)->UseRealTime();
+
+BENCHMARK_MAIN();
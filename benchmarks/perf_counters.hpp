@@ -0,0 +1,151 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Hardware counters of the calling thread over the lifetime of the scope, reported per item as user counters of the
+ * benchmark: cycles, instructions, last level cache misses and data TLB misses, plus the instructions per cycle.
+ * Shows what interleaving trades: more instructions for fewer stalls on cache misses.
+ *
+ * Declare it right before the benchmark loop and call SetItemsProcessed() before it goes out of scope:
+ *
+ *     auto counters = perf_counter_scope(state);
+ *     for (auto _: state) { ... }
+ *     state.SetItemsProcessed(items);
+ *
+ * Each counter that cannot be opened (not Linux, no PMU in a VM, perf_event_paranoid too high...) is left out of the
+ * report, the benchmark runs as usual. Counters multiplexed by the kernel are scaled to the time they were enabled.
+ */
+class perf_counter_scope {
+public:
+    explicit perf_counter_scope(benchmark::State &state) : state_(state) {
+        for (size_t i = 0; i < counter_count; ++i) {
+            fds_[i] = open_counter(events[i].type, events[i].config);
+        }
+        for (int fd: fds_) {
+            control(fd, PERF_EVENT_IOC_RESET);
+            control(fd, PERF_EVENT_IOC_ENABLE);
+        }
+    }
+
+    perf_counter_scope(const perf_counter_scope &) = delete;
+
+    perf_counter_scope &operator=(const perf_counter_scope &) = delete;
+
+    ~perf_counter_scope() {
+        std::array<double, counter_count> values{};
+        for (size_t i = 0; i < counter_count; ++i) {
+            control(fds_[i], PERF_EVENT_IOC_DISABLE);
+            values[i] = read_counter(fds_[i]);
+            close_counter(fds_[i]);
+        }
+
+        auto items = static_cast<double>(state_.items_processed());
+        if (items <= 0) {
+            items = static_cast<double>(state_.iterations());
+        }
+        if (items <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < counter_count; ++i) {
+            if (values[i] >= 0) {
+                state_.counters[std::string(events[i].name) + "/item"] = values[i] / items;
+            }
+        }
+        if (values[cycles] > 0 && values[instructions] >= 0) {
+            state_.counters["IPC"] = values[instructions] / values[cycles];
+        }
+    }
+
+private:
+    enum counter : size_t {
+        cycles,
+        instructions,
+        llc_misses,
+        dtlb_misses,
+        counter_count
+    };
+
+    struct event {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+#if defined(__linux__)
+    static constexpr uint64_t llc_read_miss = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    static constexpr uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    static constexpr std::array<event, counter_count> events{{
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"LLC-misses", PERF_TYPE_HW_CACHE, llc_read_miss},
+            {"dTLB-misses", PERF_TYPE_HW_CACHE, dtlb_read_miss},
+    }};
+
+    /* -1 when the counter is not available */
+    static int open_counter(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1; // Allowed with perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1 /* no group */, 0));
+    }
+
+    static void control(int fd, unsigned long request) {
+        if (fd >= 0) {
+            ioctl(fd, request, 0);
+        }
+    }
+
+    /* Negative when the counter is not available or never got scheduled */
+    static double read_counter(int fd) {
+        if (fd < 0) {
+            return -1;
+        }
+        struct {
+            uint64_t value, time_enabled, time_running;
+        } data{};
+        if (read(fd, &data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data.time_running == 0) {
+            return -1;
+        }
+        return static_cast<double>(data.value) * static_cast<double>(data.time_enabled) / static_cast<double>(data.time_running);
+    }
+
+    static void close_counter(int fd) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#else
+    static constexpr unsigned long PERF_EVENT_IOC_RESET = 0, PERF_EVENT_IOC_ENABLE = 0, PERF_EVENT_IOC_DISABLE = 0;
+
+    static constexpr std::array<event, counter_count> events{{{"cycles"}, {"instructions"}, {"LLC-misses"}, {"dTLB-misses"}}};
+
+    static int open_counter(uint32_t, uint64_t) { return -1; }
+
+    static void control(int, unsigned long) {}
+
+    static double read_counter(int) { return -1; }
+
+    static void close_counter(int) {}
+#endif
+
+    benchmark::State &state_;
+    std::array<int, counter_count> fds_{};
+};
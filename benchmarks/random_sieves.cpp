@@ -1,22 +1,25 @@
 #include <benchmark/benchmark.h>
 
+#include "perf_counters.hpp"
+
 #include <coro>
+#include <algorithm>
 #include <array>
+#include <numeric>
 #include <vector>
 #include <random>
+#include <ranges>
 
 constexpr size_t steps = 100'000;
 constexpr size_t worker_count = 10;
+constexpr size_t uneven_walk_count = 1'000;
+constexpr size_t uneven_mean_length = 1'000;
+constexpr size_t max_tuned_width = 32;
 
 
 /*********
  * SETUP *
  *********/
-template<typename T>
-struct prefetchable : std::suspend_always {
-    prefetchable(const T *ptr) { __builtin_prefetch((const void *) (ptr), 0, 0); }
-};
-
 template<typename T, class ForwardIt>
 static inline void rand_fill_on_host(ForwardIt first, ForwardIt last, T max) {
     std::mt19937 engine(0);
@@ -49,7 +52,21 @@ static inline size_t do_random_walk(const size_t *data, size_t start, size_t ste
 /**
  * Coroutine version of the random walk that suspends on every prefetch
  */
-static inline single_task<size_t> coro_random_walk(const size_t *data, size_t start, size_t step_count) {
+template<typename frame_policy = pooled_frames>
+static inline single_task<size_t, true, false, frame_policy> coro_random_walk(const size_t *data, size_t start, size_t step_count) {
+    size_t current = start;
+    for (size_t c = 0; c < step_count; ++c) {
+        current = data[current];
+        co_await prefetchable(data + current);
+    }
+    co_return current;
+}
+
+/**
+ * Same walk, with its frame allocated in the caller's arena
+ */
+CORO_ARENA_FRAMES_BEGIN
+static inline single_task<size_t, true, false, arena_frames> coro_random_walk(std::allocator_arg_t, frame_arena &, const size_t *data, size_t start, size_t step_count) {
     size_t current = start;
     for (size_t c = 0; c < step_count; ++c) {
         current = data[current];
@@ -57,6 +74,7 @@ static inline single_task<size_t> coro_random_walk(const size_t *data, size_t st
     }
     co_return current;
 }
+CORO_ARENA_FRAMES_END
 
 /**
  * Benchmarks
@@ -71,28 +89,53 @@ static inline std::array<size_t, worker_count> run_standard(const std::vector<si
 }
 
 
-template<size_t worker_count>
+template<size_t worker_count, typename frame_policy>
 static inline std::array<size_t, worker_count> run_coro(const std::vector<size_t> &sieve, size_t step_count) {
     auto results = std::array<size_t, worker_count>{};
-    auto coroutines = std::array<single_task<size_t>, worker_count>{};
+    auto group = task_group<single_task<size_t, true, false, frame_policy>, worker_count>{};
+    group.run(
+            std::views::iota(size_t{0}, worker_count),
+            [&](size_t start) { return coro_random_walk<frame_policy>(sieve.data(), start, step_count); },
+            [&](size_t index, size_t result) { results[index] = result; });
+    return results;
+}
 
-    //initialising the coroutines
-    for (size_t i = 0; i < worker_count; ++i) {
-        coroutines[i] = coro_random_walk(sieve.data(), i, step_count);
-    }
+template<size_t worker_count>
+static inline std::array<size_t, worker_count> run_coro_arena(frame_arena &arena, const std::vector<size_t> &sieve, size_t step_count) {
+    auto results = std::array<size_t, worker_count>{};
+    auto group = task_group<single_task<size_t, true, false, arena_frames>, worker_count>{};
+    group.run(
+            std::views::iota(size_t{0}, worker_count),
+            [&](size_t start) { return coro_random_walk(std::allocator_arg, arena, sieve.data(), start, step_count); }, // Frames are contiguous in the arena
+            [&](size_t index, size_t result) { results[index] = result; });
+    return results;
+}
 
-    for (size_t i = 0; i < step_count; ++i) {
-#pragma unroll
-        for (auto &runner: coroutines) {
-            runner();
-        }
+/**
+ * Many walks of uneven lengths: the group refills the slot of every finished walk.
+ */
+static inline size_t run_standard_uneven(const std::vector<size_t> &sieve, const std::vector<size_t> &walk_lengths) {
+    size_t acc = 0;
+    for (size_t i = 0; i < walk_lengths.size(); ++i) {
+        acc += do_random_walk(sieve.data(), i, walk_lengths[i]);
     }
+    return acc;
+}
 
-    for (size_t i = 0; i < worker_count; ++i) {
-        results[i] = *coroutines[i]();
-    }
+template<typename group_t>
+static inline size_t run_coro_uneven(group_t &group, const std::vector<size_t> &sieve, const std::vector<size_t> &walk_lengths) {
+    size_t acc = 0;
+    group.run(
+            std::views::iota(size_t{0}, walk_lengths.size()),
+            [&](size_t start) { return coro_random_walk(sieve.data(), start, walk_lengths[start]); },
+            [&](size_t, size_t result) { acc += result; });
+    return acc;
+}
 
-    return results;
+template<size_t worker_count>
+static inline size_t run_coro_uneven(const std::vector<size_t> &sieve, const std::vector<size_t> &walk_lengths) {
+    auto group = task_group<single_task<size_t>, worker_count>{};
+    return run_coro_uneven(group, sieve, walk_lengths);
 }
 
 void regular_sieve(benchmark::State &state) {
@@ -100,6 +143,7 @@ void regular_sieve(benchmark::State &state) {
     auto vec = generate_sieve(size);
     size_t processed_items = 0;
     size_t acc = 0;
+    auto counters = perf_counter_scope(state);
     for (auto _: state) {
         auto res = run_standard<worker_count>(vec, steps);
         acc = std::accumulate(res.begin(), res.end(), 0UL);
@@ -111,13 +155,18 @@ void regular_sieve(benchmark::State &state) {
 }
 
 
+/**
+ * Frames recycled by the frame pool, or straight from the heap: the baselines of coro_arena_sieve
+ */
+template<typename frame_policy>
 void coro_sieve(benchmark::State &state) {
     auto size = static_cast<size_t>(state.range(0));
     auto vec = generate_sieve(size);
     size_t processed_items = 0;
     size_t acc = 0;
+    auto counters = perf_counter_scope(state);
     for (auto _: state) {
-        auto res = run_coro<worker_count>(vec, steps);
+        auto res = run_coro<worker_count, frame_policy>(vec, steps);
         acc = std::accumulate(res.begin(), res.end(), 0UL);
         processed_items += steps * worker_count;
     }
@@ -126,7 +175,105 @@ void coro_sieve(benchmark::State &state) {
     state.SetItemsProcessed(static_cast<int64_t>(processed_items));
 }
 
+template<bool use_huge_pages>
+void coro_arena_sieve(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto vec = generate_sieve(size);
+    auto arena = frame_arena(64 * 1024, use_huge_pages);
+    size_t processed_items = 0;
+    size_t acc = 0;
+    auto counters = perf_counter_scope(state);
+    for (auto _: state) {
+        auto res = run_coro_arena<worker_count>(arena, vec, steps);
+        acc = std::accumulate(res.begin(), res.end(), 0UL);
+        processed_items += steps * worker_count;
+    }
+
+    state.SetLabel(std::string(std::to_string(acc)));
+    state.SetItemsProcessed(static_cast<int64_t>(processed_items));
+}
+
+static inline std::vector<size_t> generate_walk_lengths() {
+    std::vector<size_t> lengths(uneven_walk_count);
+    rand_fill_on_host(lengths.begin(), lengths.end(), 2 * uneven_mean_length);
+    return lengths;
+}
+
+template<bool use_coroutines>
+void uneven_sieve(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto vec = generate_sieve(size);
+    auto lengths = generate_walk_lengths();
+    auto total_steps = std::accumulate(lengths.begin(), lengths.end(), 0UL);
+    size_t processed_items = 0;
+    size_t acc = 0;
+    auto counters = perf_counter_scope(state);
+    for (auto _: state) {
+        if constexpr (use_coroutines) {
+            acc = run_coro_uneven<worker_count>(vec, lengths);
+        } else {
+            acc = run_standard_uneven(vec, lengths);
+        }
+        processed_items += total_steps;
+    }
+
+    state.SetLabel(std::string(std::to_string(acc)));
+    state.SetItemsProcessed(static_cast<int64_t>(processed_items));
+}
+
+/**
+ * Fixed widths against the auto-tuned one on the uneven walks, the chosen width is reported as a counter
+ */
+void fixed_width_sieve(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto vec = generate_sieve(size);
+    auto lengths = generate_walk_lengths();
+    auto total_steps = std::accumulate(lengths.begin(), lengths.end(), 0UL);
+    auto group = task_group<single_task<size_t>, max_tuned_width>{};
+    group.set_width(static_cast<size_t>(state.range(1)));
+    size_t processed_items = 0;
+    size_t acc = 0;
+    auto counters = perf_counter_scope(state);
+    for (auto _: state) {
+        acc = run_coro_uneven(group, vec, lengths);
+        processed_items += total_steps;
+    }
+
+    state.SetLabel(std::string(std::to_string(acc)));
+    state.SetItemsProcessed(static_cast<int64_t>(processed_items));
+    state.counters["width"] = static_cast<double>(group.width());
+}
+
+void auto_width_sieve(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto vec = generate_sieve(size);
+    auto lengths = generate_walk_lengths();
+    auto total_steps = std::accumulate(lengths.begin(), lengths.end(), 0UL);
+    auto group = task_group<single_task<size_t>, max_tuned_width>{};
+    group.set_width(worker_count);
+    group.auto_tune(); // The tuner keeps its state across the iterations
+    size_t processed_items = 0;
+    size_t acc = 0;
+    auto counters = perf_counter_scope(state);
+    for (auto _: state) {
+        acc = run_coro_uneven(group, vec, lengths);
+        processed_items += total_steps;
+    }
+
+    state.SetLabel(std::string(std::to_string(acc)));
+    state.SetItemsProcessed(static_cast<int64_t>(processed_items));
+    state.counters["width"] = static_cast<double>(group.width());
+    state.counters["converged"] = group.tuner()->converged();
+}
+
 BENCHMARK(regular_sieve)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
-BENCHMARK(coro_sieve)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(coro_sieve, pooled_frames)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(coro_sieve, heap_frames)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(coro_arena_sieve, false)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(coro_arena_sieve, true)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(uneven_sieve, false)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK_TEMPLATE(uneven_sieve, true)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
+BENCHMARK(fixed_width_sieve)->Unit(benchmark::kMillisecond)->ArgsProduct({{2000000, 16000000, 128000000}, benchmark::CreateDenseRange(1, max_tuned_width, 1)});
+BENCHMARK(auto_width_sieve)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(2000000, 200000000);
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+
+constexpr size_t chain_depth = 1'000'000;
+
+
+/*********
+ * SETUP *
+ *********/
+struct stack_probe {
+    uintptr_t top = 0;
+    uintptr_t lowest = UINTPTR_MAX;
+
+    inline void sample() noexcept {
+        lowest = std::min(lowest, reinterpret_cast<uintptr_t>(__builtin_frame_address(0)));
+    }
+};
+
+/**
+ * Each level awaits the next one, the innermost completes and the results flow back up through the continuations.
+ */
+static single_task<size_t, false> await_chain(size_t depth, stack_probe &probe) {
+    probe.sample();
+    if (depth == 0) co_return 0;
+    co_return co_await await_chain(depth - 1, probe) + 1;
+}
+
+
+/**
+ * Stack used by the whole chain compared to a single level, through the `stack_bytes` counter: it stays constant
+ * whatever the depth thanks to the symmetric transfer.
+ */
+void task_await_chain(benchmark::State &state) {
+    auto depth = static_cast<size_t>(state.range(0));
+    size_t acc = 0;
+    stack_probe probe;
+    for (auto _: state) {
+        probe.top = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        auto root = await_chain(depth, probe);
+        acc += *root();
+    }
+    benchmark::DoNotOptimize(acc);
+    state.counters["stack_bytes"] = static_cast<double>(probe.top - probe.lowest);
+    state.counters["per_level"] = benchmark::Counter(static_cast<double>(state.iterations() * depth),
+                                                     benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * depth));
+}
+
+BENCHMARK(task_await_chain)->Unit(benchmark::kMillisecond)->RangeMultiplier(10)->Range(1'000, chain_depth);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <cstdint>
+#include <string>
+
+constexpr uint64_t record_count = 1U << 15;
+
+
+/*********
+ * SETUP *
+ *********/
+/* Some dependent arithmetic per value, standing for the work of a stage */
+static inline uint64_t work(uint64_t value, int64_t rounds) {
+    for (int64_t r = 0; r < rounds; ++r) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 29;
+    }
+    return value;
+}
+
+static generator<std::string> lines(uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_yield std::to_string(i * 7919);
+    }
+}
+
+template<bool exc>
+static generator<uint64_t, exc> parse(generator<std::string, exc> source, int64_t rounds) {
+    for (auto &line: source) {
+        co_yield work(std::stoull(line), rounds);
+    }
+}
+
+template<bool exc>
+static generator<uint64_t, exc> transform(generator<uint64_t, exc> source, int64_t rounds) {
+    for (auto value: source) {
+        co_yield work(value, rounds);
+    }
+}
+
+static uint64_t aggregate(auto &&values, int64_t rounds) {
+    uint64_t acc = 0;
+    for (auto value: values) {
+        acc += work(value, rounds);
+    }
+    return acc;
+}
+
+
+/**
+ * lines -> parse -> transform -> aggregate, every stage running `rounds` of work per record
+ */
+void lockstep_generators(benchmark::State &state) {
+    auto rounds = state.range(0);
+    uint64_t acc = 0;
+    for (auto _: state) {
+        acc += aggregate(transform<true>(parse<true>(lines(record_count), rounds), rounds), rounds);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * record_count));
+}
+
+/**
+ * Same generators, each one on its own thread, the aggregation on the calling thread
+ */
+void piped_generators(benchmark::State &state) {
+    auto rounds = state.range(0);
+    uint64_t acc = 0;
+    for (auto _: state) {
+        acc += aggregate(pipe(lines(record_count),
+                              [=](generator<std::string> in) { return parse<true>(std::move(in), rounds); },
+                              [=](generator<uint64_t> in) { return transform<true>(std::move(in), rounds); }), rounds);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * record_count));
+}
+
+/**
+ * Ring depth: small rings hand over often, and stall the stages on each other's jitter
+ */
+template<size_t depth>
+void piped_depth(benchmark::State &state) {
+    auto rounds = state.range(0);
+    uint64_t acc = 0;
+    for (auto _: state) {
+        acc += aggregate(pipe<depth>(lines(record_count), [=](generator<std::string> in) { return parse<true>(std::move(in), rounds); }), rounds);
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * record_count));
+}
+
+BENCHMARK(lockstep_generators)->Unit(benchmark::kMillisecond)->Arg(0)->Arg(100)->Arg(1000);
+BENCHMARK(piped_generators)->Unit(benchmark::kMillisecond)->Arg(0)->Arg(100)->Arg(1000)->UseRealTime();
+BENCHMARK_TEMPLATE(piped_depth, 4)->Unit(benchmark::kMillisecond)->Arg(0)->Arg(100)->UseRealTime();
+BENCHMARK_TEMPLATE(piped_depth, 64)->Unit(benchmark::kMillisecond)->Arg(0)->Arg(100)->UseRealTime();
+BENCHMARK_TEMPLATE(piped_depth, 1024)->Unit(benchmark::kMillisecond)->Arg(0)->Arg(100)->UseRealTime();
+
+BENCHMARK_MAIN();
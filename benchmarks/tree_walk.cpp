@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <memory>
+#include <vector>
+
+
+/*********
+ * SETUP *
+ *********/
+struct tree_node {
+    size_t value;
+    std::vector<std::unique_ptr<tree_node>> children;
+};
+
+/**
+ * Deep and unbalanced: a spine of `depth` nodes, each one also holding a few leaves.
+ */
+static std::unique_ptr<tree_node> make_unbalanced_tree(size_t depth, size_t leaves_per_node) {
+    auto root = std::make_unique<tree_node>(tree_node{0, {}});
+    tree_node *current = root.get();
+    for (size_t level = 1; level < depth; ++level) {
+        for (size_t leaf = 0; leaf < leaves_per_node; ++leaf) {
+            current->children.emplace_back(std::make_unique<tree_node>(tree_node{level * leaves_per_node + leaf, {}}));
+        }
+        current->children.emplace_back(std::make_unique<tree_node>(tree_node{level, {}}));
+        current = current->children.back().get();
+    }
+    return root;
+}
+
+static size_t count_nodes(const tree_node &node) {
+    size_t count = 1;
+    for (auto &child: node.children) count += count_nodes(*child);
+    return count;
+}
+
+/**
+ * Every level re-yields the elements of its children: O(depth) resumes per element.
+ */
+static generator<size_t, false> flat_walk(const tree_node *node) {
+    co_yield node->value;
+    for (auto &child: node->children) {
+        for (auto value: flat_walk(child.get())) {
+            co_yield value;
+        }
+    }
+}
+
+/**
+ * The consumer resumes the innermost generator directly.
+ */
+static recursive_generator<size_t, false> recursive_walk(const tree_node *node) {
+    co_yield node->value;
+    for (auto &child: node->children) {
+        co_yield elements_of(recursive_walk(child.get()));
+    }
+}
+
+
+template<bool use_elements_of>
+void tree_walk(benchmark::State &state) {
+    auto tree = make_unbalanced_tree(static_cast<size_t>(state.range(0)), 4);
+    auto node_count = count_nodes(*tree);
+    size_t acc = 0;
+    for (auto _: state) {
+        acc = 0;
+        if constexpr (use_elements_of) {
+            for (auto value: recursive_walk(tree.get())) acc += value;
+        } else {
+            for (auto value: flat_walk(tree.get())) acc += value;
+        }
+    }
+    state.SetLabel(std::to_string(acc));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * node_count));
+}
+
+BENCHMARK_TEMPLATE(tree_walk, false)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK_TEMPLATE(tree_walk, true)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(16, 4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include <coro>
+#include <array>
+#include <cstdint>
+
+constexpr size_t record_count = 10'000;
+
+
+/*********
+ * SETUP *
+ *********/
+struct record {
+    uint64_t id;
+    std::array<uint64_t, 127> payload;
+};
+
+static_assert(sizeof(record) == 1024);
+
+/**
+ * Yields the same frame-local record updated in place. By value, every element is copied into the promise and
+ * again into the optional returned by get(); by reference, the consumer reads the record in the frame.
+ */
+template<typename T>
+static generator<T, false> records(size_t count) {
+    record current{};
+    for (size_t i = 0; i < count; ++i) {
+        current.id = i;
+        current.payload[i % current.payload.size()] += i;
+        co_yield current;
+    }
+}
+
+
+/**
+ * Benchmarks
+ */
+template<typename T>
+void records_resume(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        auto gen = records<T>(record_count);
+        while (auto r = gen()) {
+            acc += r->id + r->payload[r->id % r->payload.size()];
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * record_count));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * record_count * sizeof(record)));
+}
+
+template<typename T>
+void records_iterator(benchmark::State &state) {
+    uint64_t acc = 0;
+    for (auto _: state) {
+        for (const record &r: records<T>(record_count)) {
+            acc += r.id + r.payload[r.id % r.payload.size()];
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * record_count));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * record_count * sizeof(record)));
+}
+
+BENCHMARK_TEMPLATE(records_resume, record);
+BENCHMARK_TEMPLATE(records_resume, const record &);
+BENCHMARK_TEMPLATE(records_iterator, record);
+BENCHMARK_TEMPLATE(records_iterator, const record &);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <coro_frame_pool.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#ifdef __linux__
+
+#include <sys/mman.h>
+
+#endif
+
+/**
+ * Caller-supplied contiguous buffer for coroutine frames.
+ * Frames are bump-allocated back to back, so the frames of an interleave group share cache lines and TLB entries
+ * instead of being scattered across the heap. Releasing a frame only decrements the count of live frames, and the
+ * arena rewinds once all of them are gone, so the same buffer can be reused by the next group.
+ */
+class frame_arena {
+public:
+    static constexpr size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    static constexpr size_t huge_page_size = 2UL << 20;
+
+    /**
+     * With `use_huge_pages`, the buffer is backed by explicit huge pages when the system has some reserved,
+     * or by transparent huge pages otherwise.
+     */
+    explicit frame_arena(size_t capacity, bool use_huge_pages = false) : capacity_(round_up(capacity, alignment)) {
+#ifdef __linux__
+        void *ptr = MAP_FAILED;
+        if (use_huge_pages) {
+            capacity_ = round_up(capacity_, huge_page_size);
+            ptr = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (ptr == MAP_FAILED) {
+            ptr = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) throw std::bad_alloc();
+            if (use_huge_pages) madvise(ptr, capacity_, MADV_HUGEPAGE);
+        }
+        buffer_ = static_cast<std::byte *>(ptr);
+#else
+        (void) use_huge_pages;
+        buffer_ = static_cast<std::byte *>(::operator new(capacity_, std::align_val_t(alignment)));
+#endif
+    }
+
+    [[nodiscard]] inline void *allocate(size_t size) {
+        size = round_up(size, alignment);
+        if (size > capacity_ - offset_) {
+            throw std::bad_alloc();
+        }
+        void *ptr = buffer_ + offset_;
+        offset_ += size;
+        ++live_;
+        return ptr;
+    }
+
+    inline void deallocate(void *) noexcept {
+        if (--live_ == 0) {
+            offset_ = 0;
+        }
+    }
+
+    [[nodiscard]] inline size_t capacity() const noexcept { return capacity_; }
+
+    [[nodiscard]] inline size_t used() const noexcept { return offset_; }
+
+    [[nodiscard]] inline size_t live_frames() const noexcept { return live_; }
+
+    frame_arena(const frame_arena &) = delete;
+
+    frame_arena &operator=(const frame_arena &) = delete;
+
+    ~frame_arena() {
+#ifdef __linux__
+        munmap(buffer_, capacity_);
+#else
+        ::operator delete(buffer_, std::align_val_t(alignment));
+#endif
+    }
+
+private:
+    static constexpr size_t round_up(size_t value, size_t multiple) noexcept {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    std::byte *buffer_ = nullptr;
+    size_t capacity_;
+    size_t offset_ = 0;
+    size_t live_ = 0;
+};
+
+
+/* Bracket the definitions of the coroutines using arena_frames, see below */
+#if defined(__GNUC__) && !defined(__clang__)
+#define CORO_ARENA_FRAMES_BEGIN _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+#define CORO_ARENA_FRAMES_END _Pragma("GCC diagnostic pop")
+#else
+#define CORO_ARENA_FRAMES_BEGIN
+#define CORO_ARENA_FRAMES_END
+#endif
+
+
+/**
+ * Frame policy for coroutines following the allocator-argument convention: when the coroutine takes
+ * `std::allocator_arg_t, frame_arena &` as leading parameters (after the object for member functions), its frame
+ * is carved out of that arena. Otherwise it comes from the frame_pool.
+ * Each frame is prefixed by the arena it came from so that the deallocation finds its way back.
+ *
+ * GCC 12 pairs the coroutine's usual operator delete with the member template operator new by name, and flags the
+ * coroutine with a false -Wmismatched-new-delete, reported where the coroutine is defined. No operator delete can
+ * match a template operator new and still be the usual one, so the definitions go between CORO_ARENA_FRAMES_BEGIN and
+ * CORO_ARENA_FRAMES_END, which silence that warning only.
+ */
+struct arena_frames {
+    template<typename... Args>
+    static void *operator new(size_t size, std::allocator_arg_t, frame_arena &arena, Args const &...) {
+        return prefix(arena.allocate(size + header_size), &arena);
+    }
+
+    template<typename Self, typename... Args>
+    static void *operator new(size_t size, Self const &, std::allocator_arg_t, frame_arena &arena, Args const &...) {
+        return prefix(arena.allocate(size + header_size), &arena);
+    }
+
+    static void *operator new(size_t size) {
+        return prefix(frame_pool::local().allocate(size + header_size), nullptr);
+    }
+
+    static void operator delete(void *ptr, size_t size) noexcept {
+        void *block = static_cast<std::byte *>(ptr) - header_size;
+        if (auto *arena = *static_cast<frame_arena **>(block)) {
+            arena->deallocate(block);
+        } else {
+            frame_pool::local().deallocate(block, size + header_size);
+        }
+    }
+
+private:
+    static constexpr size_t header_size = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    static inline void *prefix(void *block, frame_arena *arena) noexcept {
+        ::new(block) frame_arena *(arena);
+        return static_cast<std::byte *>(block) + header_size;
+    }
+};
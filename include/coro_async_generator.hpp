@@ -0,0 +1,236 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+
+#include <coroutine>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A generator whose body can `co_await` anything between its yields: events, timers, tasks, an executor...
+ * It is consumed from another coroutine, which suspends until the next value is there:
+ *
+ *     while (auto value = co_await gen.next()) { ... }
+ *     for (auto it = co_await gen.begin(); it != gen.end(); co_await ++it) { ... }
+ *
+ * Pulling a value transfers control to the generator and yielding transfers it back, both through symmetric
+ * transfer. When the body suspends on something else, the consumer stays suspended and whoever completes the
+ * awaited operation resumes the body, which carries on until its next value.
+ *
+ * The promise is a link of the task chain of the consumer: when the consumer is a single_task driven by resume(),
+ * such as the tasks of an event_pipeline, the generator is the leaf of the chain while it runs. Resuming the chain
+ * then resumes the generator, and its waits on pollable events are reported to the pipeline: one thread polls and
+ * multiplexes any number of slow streams.
+ *
+ * With a reference `T` the values are yielded by reference and next() returns a pointer, valid until the next pull.
+ * Otherwise next() moves the value out, in an optional. Template parameters as for generator.
+ */
+template<typename T, bool enable_exceptions_propagation = true, typename frame_policy = pooled_frames, typename instrumentation = untraced>
+class async_generator {
+public:
+    using result_type = conditional_type_t<std::remove_reference_t<T> *, std::optional<T>, std::is_reference_v<T>>;
+
+    struct promise_type : task_link, value_holder<T, enable_exceptions_propagation>, instrumentation::template frames<frame_policy>, instrumentation {
+        using value_holder_t = value_holder<T, enable_exceptions_propagation>;
+
+        async_generator get_return_object() noexcept {
+            return async_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        static constexpr auto initial_suspend() noexcept { return instrumentation::wrap(std::suspend_always{}); }
+
+        static constexpr auto final_suspend() noexcept { return instrumentation::template wrap<true>(final_awaiter{}); }
+
+        constexpr void unhandled_exception() noexcept {
+            if constexpr (enable_exceptions_propagation) {
+                value_holder_t::set_exception(std::current_exception());
+            }
+        }
+
+        template<typename U = T>
+        constexpr auto yield_value(U &&val) noexcept {
+            value_holder_t::set_value(std::forward<U>(val));
+            return instrumentation::wrap(yield_awaiter{});
+        }
+
+        template<typename U = T>
+        constexpr auto yield_value(const U &val) noexcept {
+            value_holder_t::set_value(val);
+            return instrumentation::wrap(yield_awaiter{});
+        }
+
+        constexpr void return_void() const noexcept {}
+
+        /* Hands the value over to the consumer, which becomes the leaf of its chain again */
+        struct yield_awaiter {
+            static constexpr bool await_ready() noexcept { return false; }
+
+            inline std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) const noexcept {
+                task_link &link = self.promise();
+                auto consumer = std::coroutine_handle<>::from_address(link.continuation_.load(std::memory_order_relaxed));
+                if (link.root_) {
+                    link.root_->leaf_.store(consumer.address(), std::memory_order_relaxed);
+                }
+                return consumer;
+            }
+
+            static constexpr void await_resume() noexcept {}
+        };
+
+        /* Runs the body up to its next value, on behalf of `consumer` */
+        template<typename consumer_promise>
+        inline std::coroutine_handle<> pull_from(std::coroutine_handle<consumer_promise> consumer, std::coroutine_handle<promise_type> self) noexcept {
+            continuation_.store(consumer.address(), std::memory_order_relaxed);
+            if constexpr (std::is_base_of_v<task_link, consumer_promise>) {
+                root_ = &chain_root(consumer.promise());
+                root_->leaf_.store(self.address(), std::memory_order_relaxed);
+            } else {
+                root_ = nullptr;
+            }
+            return self;
+        }
+    };
+
+private:
+    /* Resumes the body until it yields or completes, then rethrows its exception if any */
+    struct advance_awaiter {
+        async_generator &gen_;
+
+        [[nodiscard]] inline bool await_ready() const noexcept { return !gen_.handle_ || gen_.handle_.done(); }
+
+        template<typename consumer_promise>
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<consumer_promise> consumer) noexcept {
+            return gen_.handle_.promise().pull_from(consumer, gen_.handle_);
+        }
+
+        inline void await_resume() noexcept(!enable_exceptions_propagation) {
+            if constexpr (enable_exceptions_propagation) {
+                gen_.rethrow_exceptions();
+            }
+        }
+    };
+
+public:
+    /* `co_await gen.next()`: the next value, empty once the body has returned */
+    [[nodiscard]] inline auto next() noexcept {
+        struct next_awaiter : advance_awaiter {
+            inline result_type await_resume() noexcept(!enable_exceptions_propagation) {
+                advance_awaiter::await_resume();
+                if (!this->gen_.handle_ || this->gen_.handle_.done()) {
+                    return result_type{};
+                }
+                if constexpr (std::is_reference_v<T>) {
+                    return std::addressof(this->gen_.handle_.promise().get_value());
+                } else {
+                    return result_type(this->gen_.handle_.promise().take_value());
+                }
+            }
+        };
+        return next_awaiter{{*this}};
+    }
+
+    /**
+     * Reads the current value in place, equal to std::default_sentinel once the generator is exhausted.
+     * Incrementing it is awaited, `co_await ++it`, so it is not a standard iterator.
+     */
+    class iterator {
+    public:
+        using value_type = std::remove_cvref_t<T>;
+        using reference = std::remove_reference_t<T> &;
+
+        explicit iterator(async_generator *gen = nullptr) noexcept: gen_(gen) {}
+
+        [[nodiscard]] inline auto operator++() noexcept {
+            struct increment_awaiter : advance_awaiter {
+                iterator &it_;
+
+                inline iterator &await_resume() noexcept(!enable_exceptions_propagation) {
+                    advance_awaiter::await_resume();
+                    return it_;
+                }
+            };
+            return increment_awaiter{{*gen_}, *this};
+        }
+
+        inline reference operator*() const noexcept { return gen_->handle_.promise().get_value(); }
+
+        inline std::remove_reference_t<T> *operator->() const noexcept { return std::addressof(**this); }
+
+        friend inline bool operator==(const iterator &it, std::default_sentinel_t) noexcept {
+            return it.gen_->done();
+        }
+
+    private:
+        async_generator *gen_;
+    };
+
+    /* `co_await gen.begin()`: runs the body up to its first value */
+    [[nodiscard]] inline auto begin() noexcept {
+        struct begin_awaiter : advance_awaiter {
+            inline iterator await_resume() noexcept(!enable_exceptions_propagation) {
+                advance_awaiter::await_resume();
+                return iterator(&this->gen_);
+            }
+        };
+        return begin_awaiter{{*this}};
+    }
+
+    static constexpr std::default_sentinel_t end() noexcept { return {}; }
+
+    [[nodiscard]] inline bool done() const noexcept { return !handle_ || handle_.done(); }
+
+    void destroy() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+private:
+    void rethrow_exceptions() requires(enable_exceptions_propagation) {
+        if (!handle_) {
+            throw std::runtime_error("Called coroutine on empty/destroyed handle"s);
+        }
+        if (auto ptr = handle_.promise().get_exception_ptr()) {
+            destroy();
+            std::rethrow_exception(ptr);
+        }
+    }
+
+public:
+    async_generator() = default;
+
+    explicit async_generator(std::coroutine_handle<promise_type> handle) noexcept: handle_(handle) {}
+
+    async_generator(const async_generator &) = delete;
+
+    async_generator(async_generator &&other) noexcept: handle_(std::exchange(other.handle_, nullptr)) {}
+
+    async_generator &operator=(const async_generator &) = delete;
+
+    async_generator &operator=(async_generator &&other) noexcept {
+        if (&other != this) {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~async_generator() {
+        destroy();
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+
+static constexpr void static_tests_async_generator() {
+    static_assert(sizeof(async_generator<int>) == sizeof(std::coroutine_handle<void>));
+    static_assert(std::is_same_v<async_generator<int>::result_type, std::optional<int>>);
+    static_assert(std::is_same_v<async_generator<const int &>::result_type, const int *>);
+}
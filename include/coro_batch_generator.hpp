@@ -0,0 +1,279 @@
+#pragma once
+
+#include <helpers.hpp>
+#include <coro_frame_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std::string_literals;
+
+/**
+ * Generator that hands its values out by batches, to amortise the resume over up to `batch_size` elements.
+ * The producer still writes `co_yield value;`: the value is appended to a buffer in the promise and the coroutine
+ * only suspends once the buffer is full, or when it completes with a partial batch.
+ * It can also `co_yield` a `std::span<const T>` of values computed in a plain loop, which are copied in bulk.
+ * A span larger than the room left is drained by next_batch() before the producer is resumed, so it must stay
+ * alive until the co_yield returns, like a value yielded by reference.
+ *
+ * The consumer either walks the values with the flattening iterator, or takes whole batches with next_batch()
+ * and runs plain loops over the spans, which the compiler can vectorise (see batch_sum(), batch_min(), batch_max()).
+ * A batch stays valid until the next call to next_batch(). If the producer throws, the values it yielded before are
+ * handed out first, and the exception is rethrown by the next call.
+ */
+template<typename T, size_t batch_size = 256, bool enable_exceptions_propagation = true, typename frame_policy = pooled_frames>
+struct batch_generator {
+
+    static_assert(batch_size > 0);
+    static_assert(std::is_default_constructible_v<T> && !std::is_reference_v<T>);
+
+public:
+    struct batch_promise_type : frame_policy {
+    public:
+        batch_generator get_return_object() noexcept {
+            return batch_generator(std::coroutine_handle<batch_promise_type>::from_promise(*this));
+        }
+
+        static constexpr auto initial_suspend() noexcept { return std::suspend_always{}; }
+
+        static constexpr auto final_suspend() noexcept { return std::suspend_always{}; }
+
+        constexpr void unhandled_exception() noexcept {
+            if constexpr(enable_exceptions_propagation) {
+                exception_ = std::current_exception();
+            }
+        }
+
+        /* Suspends only when the buffer is full */
+        struct batch_awaiter {
+            bool full_;
+
+            [[nodiscard]] constexpr bool await_ready() const noexcept { return !full_; }
+
+            static constexpr void await_suspend(std::coroutine_handle<>) noexcept {}
+
+            static constexpr void await_resume() noexcept {}
+        };
+
+        template<typename U = T>
+        constexpr batch_awaiter yield_value(U &&val) noexcept(std::is_nothrow_assignable_v<T &, U &&>) requires(std::is_assignable_v<T &, U &&>) {
+            buffer_[size_++] = std::forward<U>(val);
+            return batch_awaiter{size_ == batch_size};
+        }
+
+        constexpr batch_awaiter yield_value(std::span<const T> values) {
+            pending_ = values;
+            append_pending();
+            return batch_awaiter{size_ == batch_size};
+        }
+
+        /* Copies as much of the pending values as the buffer can take */
+        inline void append_pending() {
+            size_t count = std::min(batch_size - size_, pending_.size());
+            std::copy_n(pending_.begin(), count, buffer_.begin() + static_cast<ptrdiff_t>(size_));
+            size_ += count;
+            pending_ = pending_.subspan(count);
+        }
+
+        constexpr void return_void() const noexcept {}
+
+        std::array<T, batch_size> buffer_;
+        size_t size_ = 0;
+        std::span<const T> pending_{};
+        [[no_unique_address]] optional_type_t<std::exception_ptr, enable_exceptions_propagation> exception_;
+    };
+
+    using promise_type = batch_promise_type;
+
+public:
+    /**
+     * Flattens the batches. Equal to the default sentinel once the generator is exhausted.
+     */
+    struct iterator {
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = T;
+
+        iterator() = default;
+
+        explicit iterator(batch_generator *gen) : gen_(gen), batch_(gen->next_batch()) {}
+
+        inline iterator &operator++() noexcept(!enable_exceptions_propagation) {
+            if (++position_ == batch_.size()) [[unlikely]] {
+                batch_ = gen_->next_batch();
+                position_ = 0;
+            }
+            return *this;
+        }
+
+        inline void operator++(int) noexcept(!enable_exceptions_propagation) { ++*this; }
+
+        inline T &operator*() const noexcept { return batch_[position_]; }
+
+        constexpr bool operator==(std::default_sentinel_t) const noexcept { return batch_.empty(); }
+
+    private:
+        batch_generator *gen_ = nullptr;
+        std::span<T> batch_{};
+        size_t position_ = 0;
+    };
+
+    iterator begin() noexcept(!enable_exceptions_propagation) { return iterator(this); }
+
+    static constexpr std::default_sentinel_t end() noexcept { return {}; }
+
+    /* Runs the producer until it fills a batch or completes, the span is empty once it is exhausted */
+    std::span<T> next_batch() noexcept(!enable_exceptions_propagation) {
+        if (!handle_) {
+            if constexpr (enable_exceptions_propagation) {
+                throw std::runtime_error("Called coroutine on empty/destroyed handle"s);
+            }
+            return {};
+        }
+        auto &promise = handle_.promise();
+        promise.size_ = 0;
+        if constexpr (enable_exceptions_propagation) {
+            if (auto ptr = promise.exception_) {
+                destroy();
+                std::rethrow_exception(ptr);
+            }
+        }
+        if (!promise.pending_.empty()) {
+            promise.append_pending();
+            if (promise.size_ == batch_size) {
+                return {promise.buffer_.data(), promise.size_};
+            }
+        }
+        if (handle_.done()) {
+            return {promise.buffer_.data(), promise.size_};
+        }
+        handle_.resume();
+        if constexpr (enable_exceptions_propagation) {
+            if (auto ptr = promise.exception_; ptr && promise.size_ == 0) {
+                destroy();
+                std::rethrow_exception(ptr);
+            }
+        }
+        return {promise.buffer_.data(), promise.size_};
+    }
+
+    void destroy() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    bool done() const noexcept {
+        return handle_.done();
+    }
+
+    static constexpr size_t capacity() noexcept { return batch_size; }
+
+public:
+    batch_generator() = default;
+
+    explicit batch_generator(std::coroutine_handle<batch_promise_type> handle) : handle_(handle) {}
+
+    batch_generator(const batch_generator &) = delete;
+
+    batch_generator(batch_generator &&other) noexcept: handle_(std::exchange(other.handle_, nullptr)) {}
+
+    batch_generator &operator=(const batch_generator &) = delete;
+
+    batch_generator &operator=(batch_generator &&other) noexcept {
+        if (&other != this) {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~batch_generator() {
+        destroy();
+    }
+
+private:
+    std::coroutine_handle<batch_promise_type> handle_;
+};
+
+
+/**
+ * Span-wise reductions. Each batch is folded into `lanes` independent accumulators so that the loop has no
+ * dependency between consecutive elements and vectorises without reassociating, floating point sums included.
+ */
+namespace batch_detail {
+    constexpr size_t lanes = 16;
+
+    template<typename T, typename Op>
+    inline void fold_lanes(std::array<T, lanes> &acc, std::span<const T> batch, Op op) noexcept {
+        size_t i = 0;
+        for (; i + lanes <= batch.size(); i += lanes) {
+            for (size_t l = 0; l < lanes; ++l) {
+                acc[l] = op(acc[l], batch[i + l]);
+            }
+        }
+        for (size_t l = 0; i < batch.size(); ++i, ++l) {
+            acc[l] = op(acc[l], batch[i]);
+        }
+    }
+
+    template<typename T, typename Op>
+    inline T reduce_lanes(const std::array<T, lanes> &acc, Op op) noexcept {
+        T result = acc[0];
+        for (size_t l = 1; l < lanes; ++l) {
+            result = op(result, acc[l]);
+        }
+        return result;
+    }
+
+    template<typename T, typename gen_t, typename Op>
+    inline std::optional<T> fold(gen_t &gen, Op op) {
+        auto batch = gen.next_batch();
+        if (batch.empty()) {
+            return std::nullopt;
+        }
+        auto acc = std::array<T, lanes>{};
+        acc.fill(batch[0]);
+        do {
+            fold_lanes<T>(acc, batch, op);
+        } while (!(batch = gen.next_batch()).empty());
+        return reduce_lanes(acc, op);
+    }
+}
+
+template<typename T, size_t batch_size, bool exc, typename frame_policy>
+T batch_sum(batch_generator<T, batch_size, exc, frame_policy> &gen, T init = T{}) {
+    auto acc = std::array<T, batch_detail::lanes>{};
+    for (auto batch = gen.next_batch(); !batch.empty(); batch = gen.next_batch()) {
+        batch_detail::fold_lanes<T>(acc, batch, [](T a, T b) { return a + b; });
+    }
+    return init + batch_detail::reduce_lanes(acc, [](T a, T b) { return a + b; });
+}
+
+/* std::nullopt if the generator yields nothing */
+template<typename T, size_t batch_size, bool exc, typename frame_policy>
+std::optional<T> batch_min(batch_generator<T, batch_size, exc, frame_policy> &gen) {
+    return batch_detail::fold<T>(gen, [](T a, T b) { return b < a ? b : a; });
+}
+
+template<typename T, size_t batch_size, bool exc, typename frame_policy>
+std::optional<T> batch_max(batch_generator<T, batch_size, exc, frame_policy> &gen) {
+    return batch_detail::fold<T>(gen, [](T a, T b) { return a < b ? b : a; });
+}
+
+
+static constexpr void static_tests_batch_generator() {
+    static_assert(sizeof(batch_generator<float>) == sizeof(std::coroutine_handle<void>));
+    static_assert(std::input_iterator<batch_generator<float>::iterator>);
+    static_assert(std::sentinel_for<std::default_sentinel_t, batch_generator<float>::iterator>);
+    static_assert(sizeof(batch_generator<float, 64, false>::promise_type) == 64 * sizeof(float) + sizeof(size_t) + sizeof(std::span<const float>));
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <coro_event_pipeline.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace channel_detail {
+
+    /**
+     * A send or a receive suspended on a channel, linked in its list of waiters: the nodes are the awaiters
+     * themselves, in the frames of the waiting coroutines, so waiting allocates nothing.
+     * Completing a waiter resumes its coroutine in place. In an event_pipeline the waiter is the pollable event of
+     * the task instead, and the pipeline resumes the task once it sees the waiter complete.
+     */
+    struct waiter {
+        waiter *next_ = nullptr;
+        std::coroutine_handle<> handle_{};
+        std::atomic<bool> done_{false};
+
+        [[nodiscard]] inline bool is_complete() const noexcept { return done_.load(std::memory_order_acquire); }
+
+        /**
+         * `link()` links the waiter to the channel and returns whether the coroutine stays suspended. The waiter may
+         * be completed as soon as linked, so it is only reported to the pipeline, by address, afterwards.
+         */
+        template<typename Link>
+        inline bool suspend(std::coroutine_handle<> awaiting, Link &&link) {
+            auto *wait = pending_wait::current;
+            handle_ = wait ? std::coroutine_handle<>() : awaiting;
+            if (!link()) {
+                return false;
+            }
+            if (wait) {
+                wait->event = this;
+                wait->is_complete = [](const void *w) -> bool { return static_cast<const waiter *>(w)->is_complete(); };
+            }
+            return true;
+        }
+
+        /* The waiter may be gone as soon as it is seen complete: nothing is read after */
+        inline void complete() noexcept {
+            auto handle = handle_;
+            done_.store(true, std::memory_order_release);
+            if (handle) {
+                handle.resume();
+            }
+        }
+    };
+
+    /* FIFO of waiters, through their `next_` link */
+    template<typename waiter_t>
+    struct waiter_list {
+        waiter_t *head_ = nullptr;
+        waiter_t *tail_ = nullptr;
+
+        [[nodiscard]] inline bool empty() const noexcept { return !head_; }
+
+        inline void push_back(waiter_t *w) noexcept {
+            w->next_ = nullptr;
+            if (tail_) {
+                tail_->next_ = w;
+            } else {
+                head_ = w;
+            }
+            tail_ = w;
+        }
+
+        inline waiter_t *pop_front() noexcept {
+            auto *w = head_;
+            head_ = static_cast<waiter_t *>(w->next_);
+            if (!head_) tail_ = nullptr;
+            return w;
+        }
+    };
+
+    /**
+     * Bounded lock-free MPMC ring (Vyukov). Each cell carries a sequence number telling whether it is ready to be
+     * written or read for the current lap, so producers and consumers only contend on their own position counter.
+     * A cell is claimed before the value is moved in or out, and a throwing move would leave it claimed for good:
+     * the values must be nothrow move constructible.
+     */
+    template<typename T>
+    class mpmc_ring {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "A throwing move would wedge the ring");
+
+    public:
+        explicit mpmc_ring(size_t capacity) : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), cells_(std::make_unique<cell[]>(mask_ + 1)) {
+            for (size_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~mpmc_ring() {
+            std::optional<T> value;
+            while (try_pop(value)) {}
+        }
+
+        /* Moves `value` in, unless the ring is full */
+        bool try_push(T &value) {
+            auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+            cell *c;
+            while (true) {
+                c = &cells_[pos & mask_];
+                auto diff = static_cast<int64_t>(c->sequence.load(std::memory_order_acquire) - pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            std::construct_at(c->value(), std::move(value));
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* Moves the oldest value into `out`, unless the ring is empty */
+        bool try_pop(std::optional<T> &out) {
+            auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+            cell *c;
+            while (true) {
+                c = &cells_[pos & mask_];
+                auto diff = static_cast<int64_t>(c->sequence.load(std::memory_order_acquire) - (pos + 1));
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            out.emplace(std::move(*c->value()));
+            std::destroy_at(c->value());
+            c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] inline size_t capacity() const noexcept { return mask_ + 1; }
+
+    private:
+        struct cell {
+            std::atomic<uint64_t> sequence;
+            alignas(T) std::byte storage[sizeof(T)];
+
+            inline T *value() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+        };
+
+        const size_t mask_;
+        std::unique_ptr<cell[]> cells_;
+        alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+        alignas(64) std::atomic<uint64_t> dequeue_pos_{0};
+    };
+}
+
+
+/**
+ * Bounded multi-producer multi-consumer channel between coroutines: `co_await ch.send(value)` suspends while the
+ * channel is full, `co_await ch.recv()` while it is empty. The values go through a lock-free ring, which is all
+ * that senders and receivers touch as long as nobody waits.
+ *
+ * A coroutine that has to wait links its awaiter into the channel's list of waiting senders or receivers, under a
+ * mutex, then looks at the ring once more. Every successful send or receive looks for waiters after a fence and, if
+ * there are any, hands them values or room in the ring and resumes them, in place, on its own thread: a receiver
+ * woken by a sender on another thread carries on there. In an event_pipeline, the waiting task is polled and resumed
+ * by its pipeline instead, so a single-threaded loop of tasks exchanging values works as well.
+ *
+ * close() ends the channel: sends then fail, and receives return what is left in the ring, then std::nullopt.
+ * A send racing with close() may be lost. The capacity is rounded up to a power of two, 2 at least.
+ * T must be nothrow move constructible, as the values are moved in and out of ring cells already claimed.
+ */
+template<typename T>
+class channel {
+    using ring_t = channel_detail::mpmc_ring<T>;
+
+public:
+    explicit channel(size_t capacity) : ring_(capacity) {}
+
+    channel(const channel &) = delete;
+
+    channel &operator=(const channel &) = delete;
+
+    /* `co_await ch.send(value)`: false if the channel is closed, the value is then dropped */
+    class send_awaiter : channel_detail::waiter {
+    public:
+        send_awaiter(channel &ch, T value) : channel_(ch), value_(std::move(value)) {}
+
+        inline bool await_ready() {
+            sent_ = !channel_.closed() && channel_.try_send_value(value_);
+            return sent_ || channel_.closed();
+        }
+
+        inline bool await_suspend(std::coroutine_handle<> awaiting) {
+            return suspend(awaiting, [this]() { return channel_.wait_to_send(*this); });
+        }
+
+        [[nodiscard]] inline bool await_resume() const noexcept { return sent_; }
+
+    private:
+        friend class channel;
+        friend struct channel_detail::waiter_list<send_awaiter>;
+
+        channel &channel_;
+        T value_;
+        bool sent_ = false;
+    };
+
+    /* `co_await ch.recv()`: the next value, std::nullopt once the channel is closed and empty */
+    class recv_awaiter : channel_detail::waiter {
+    public:
+        explicit recv_awaiter(channel &ch) noexcept: channel_(ch) {}
+
+        inline bool await_ready() {
+            return channel_.try_recv_value(value_) || channel_.closed();
+        }
+
+        inline bool await_suspend(std::coroutine_handle<> awaiting) {
+            return suspend(awaiting, [this]() { return channel_.wait_to_recv(*this); });
+        }
+
+        inline std::optional<T> await_resume() noexcept(std::is_nothrow_move_constructible_v<T>) { return std::move(value_); }
+
+    private:
+        friend class channel;
+        friend struct channel_detail::waiter_list<recv_awaiter>;
+
+        channel &channel_;
+        std::optional<T> value_;
+    };
+
+    [[nodiscard]] inline send_awaiter send(T value) { return send_awaiter(*this, std::move(value)); }
+
+    [[nodiscard]] inline recv_awaiter recv() noexcept { return recv_awaiter(*this); }
+
+    /* Without suspending: false if the channel is full or closed, the value is then left as it was */
+    inline bool try_send(T &value) {
+        return !closed() && try_send_value(value);
+    }
+
+    /* Without suspending: std::nullopt if the channel is empty */
+    inline std::optional<T> try_recv() {
+        std::optional<T> value;
+        try_recv_value(value);
+        return value;
+    }
+
+    /* Fails the waiting senders and ends the waiting receivers once the ring is drained */
+    void close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        dispatch();
+    }
+
+    [[nodiscard]] inline bool closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] inline size_t capacity() const noexcept { return ring_.capacity(); }
+
+private:
+    using waiter = channel_detail::waiter;
+
+    inline bool try_send_value(T &value) {
+        if (!ring_.try_push(value)) return false;
+        notify();
+        return true;
+    }
+
+    inline bool try_recv_value(std::optional<T> &value) {
+        if (!ring_.try_pop(value)) return false;
+        notify();
+        return true;
+    }
+
+    /* After a successful send or receive: whoever waits for a value or for room may now go on */
+    inline void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) > 0) {
+            dispatch();
+        }
+    }
+
+    /**
+     * Announces the waiter, then tries once more: a sender that pushed before the announcement is seen here, one
+     * that pushes after sees the announcement and dispatches. Returns whether the coroutine stays suspended.
+     */
+    bool wait_to_recv(recv_awaiter &receiver) {
+        bool received;
+        {
+            std::lock_guard lock(mutex_);
+            waiting_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            received = ring_.try_pop(receiver.value_);
+            if (!received && !closed_.load(std::memory_order_seq_cst)) {
+                receivers_.push_back(&receiver);
+                return true;
+            }
+            waiting_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (received) notify();
+        return false;
+    }
+
+    bool wait_to_send(send_awaiter &sender) {
+        {
+            std::lock_guard lock(mutex_);
+            waiting_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!closed_.load(std::memory_order_seq_cst)) {
+                sender.sent_ = ring_.try_push(sender.value_);
+                if (!sender.sent_) {
+                    senders_.push_back(&sender);
+                    return true;
+                }
+            }
+            waiting_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (sender.sent_) notify();
+        return false;
+    }
+
+    /**
+     * Serves the waiters from the ring, and the ring from the waiting senders, until neither can go on. On a closed
+     * channel, the senders left fail and the receivers left get nothing. The waiters served are completed once the
+     * mutex is released, as they may resume right away and use the channel again.
+     */
+    void dispatch() {
+        waiter *served = nullptr;
+        {
+            std::lock_guard lock(mutex_);
+            auto serve = [&](waiter *w) {
+                w->next_ = served;
+                served = w;
+                waiting_.fetch_sub(1, std::memory_order_relaxed);
+            };
+            for (bool progress = true; progress;) {
+                progress = false;
+                while (!receivers_.empty() && ring_.try_pop(receivers_.head_->value_)) {
+                    serve(receivers_.pop_front());
+                    progress = true;
+                }
+                while (!senders_.empty() && ring_.try_push(senders_.head_->value_)) {
+                    senders_.head_->sent_ = true;
+                    serve(senders_.pop_front());
+                    progress = true;
+                }
+            }
+            if (closed_.load(std::memory_order_seq_cst)) {
+                while (!senders_.empty()) serve(senders_.pop_front());
+                while (!receivers_.empty()) serve(receivers_.pop_front());
+            }
+        }
+        while (served) {
+            auto *next = served->next_;
+            served->complete();
+            served = next;
+        }
+    }
+
+    ring_t ring_;
+    alignas(64) std::atomic<size_t> waiting_{0};
+    std::atomic<bool> closed_{false};
+    std::mutex mutex_;
+    channel_detail::waiter_list<send_awaiter> senders_;
+    channel_detail::waiter_list<recv_awaiter> receivers_;
+};
+
+
+static constexpr void static_tests_channel() {
+    static_assert(pollable<channel_detail::waiter>);
+    static_assert(std::is_same_v<decltype(std::declval<channel<int>::recv_awaiter>().await_resume()), std::optional<int>>);
+    static_assert(std::is_same_v<decltype(std::declval<channel<int>::send_awaiter>().await_resume()), bool>);
+}
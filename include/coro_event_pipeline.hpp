@@ -0,0 +1,274 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * Anything that can be asked, without blocking, whether it has completed: device events, timers, host work...
+ */
+template<typename event_t>
+concept pollable = requires(const event_t &event) {
+    { event.is_complete() } -> std::convertible_to<bool>;
+};
+
+/**
+ * What a pipelined task is suspended on. The awaiter of the task fills it in when suspending, so that the
+ * pipeline can poll the event without knowing its type, and resumes the task only once it is complete.
+ */
+struct pending_wait {
+    const void *event = nullptr;
+    bool (*is_complete)(const void *) = nullptr;
+
+    /* A task suspended on anything else than a pollable event is always ready to move on */
+    [[nodiscard]] inline bool ready() const { return !event || is_complete(event); }
+
+    /* The wait of the task being run by a pipeline on this thread, if any */
+    static inline thread_local pending_wait *current = nullptr;
+};
+
+/**
+ * `co_await wait_for(event);` suspends the task until the event completes.
+ * In a pipeline, the task is only resumed once the event reports completion. Outside of one, there is no one to
+ * poll the event, so the awaiter waits for it in place.
+ */
+template<pollable event_t>
+struct event_awaiter {
+    event_t event;
+
+    [[nodiscard]] inline bool await_ready() const { return event.is_complete(); }
+
+    inline bool await_suspend(std::coroutine_handle<>) {
+        if (auto *wait = pending_wait::current) {
+            wait->event = &event; // The awaiter lives in the frame until the task is resumed
+            wait->is_complete = [](const void *e) -> bool { return static_cast<const event_t *>(e)->is_complete(); };
+            return true;
+        }
+        while (!event.is_complete()) {
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    static constexpr void await_resume() noexcept {}
+};
+
+template<pollable event_t>
+inline event_awaiter<std::remove_cvref_t<event_t>> wait_for(event_t &&event) {
+    return {std::forward<event_t>(event)};
+}
+
+
+enum class delivery {
+    in_order, // Results come out in the order the tasks were launched
+    completion_order // Results come out as soon as they are available
+};
+
+/**
+ * Keeps up to `max_in_flight` tasks running, each suspended on pollable events (see wait_for()).
+ * poll() checks the events of the running tasks and resumes only those whose event has completed, then hands
+ * out the next result according to the `order` policy. A slot is in flight from its launch until its result has
+ * been delivered, so a slow task in front of an in-order pipeline holds back at most `max_in_flight` tasks.
+ *
+ * Tasks are created through launch(), so that a task starting immediately reports its first wait to the pipeline.
+ * With exceptions propagation, the exception of a task is rethrown when its result would be delivered.
+ */
+template<typename task_t, delivery order = delivery::in_order>
+class event_pipeline {
+    using value_type = typename task_t::value_type;
+
+public:
+    using result_type = std::conditional_t<std::is_void_v<value_type>, std::monostate, value_type>;
+
+    explicit event_pipeline(size_t max_in_flight) : slots_(max_in_flight) {
+        free_.reserve(max_in_flight);
+        running_.reserve(max_in_flight);
+        for (size_t i = max_in_flight; i > 0; --i) {
+            free_.push_back(i - 1);
+        }
+    }
+
+    /* Creates a task with `make_task()` if there is room for it */
+    template<std::invocable Factory>
+    bool launch(Factory &&make_task) {
+        if (full()) {
+            return false;
+        }
+        size_t index = free_.back();
+        auto &slot = slots_[index];
+        {
+            auto scope = wait_scope(slot.wait);
+            slot.task = make_task();
+        }
+        free_.pop_back();
+        if constexpr (order == delivery::in_order) {
+            launched_.push_back(index);
+        }
+        running_.push_back(index);
+        if (handle(index).done()) {
+            finish(running_.size() - 1);
+        }
+        return true;
+    }
+
+    /* Resumes the tasks whose event has completed, and returns the next result if there is one */
+    std::optional<result_type> poll() {
+        for (size_t i = 0; i < running_.size();) {
+            auto &slot = slots_[running_[i]];
+            if (slot.wait.ready()) {
+                auto h = handle(running_[i]);
+                {
+                    auto scope = wait_scope(slot.wait);
+                    h.promise().resume_chain(h);
+                }
+                if (h.done()) {
+                    finish(i);
+                    continue;
+                }
+            }
+            ++i;
+        }
+        return deliver();
+    }
+
+    /* Polls until a result is available, std::nullopt if the pipeline is empty */
+    std::optional<result_type> next() {
+        while (!empty()) {
+            if (auto result = poll()) {
+                return result;
+            }
+            std::this_thread::yield();
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] inline size_t in_flight() const noexcept { return slots_.size() - free_.size(); }
+
+    [[nodiscard]] inline bool full() const noexcept { return free_.empty(); }
+
+    [[nodiscard]] inline bool empty() const noexcept { return free_.size() == slots_.size(); }
+
+    [[nodiscard]] inline size_t capacity() const noexcept { return slots_.size(); }
+
+private:
+    struct slot_t {
+        task_t task;
+        pending_wait wait;
+        bool done = false;
+    };
+
+    /* Publishes the wait of the task being run, restored even if the task creation throws */
+    struct wait_scope {
+        explicit wait_scope(pending_wait &wait) noexcept : previous_(std::exchange(pending_wait::current, &wait)) { wait = {}; }
+
+        ~wait_scope() noexcept { pending_wait::current = previous_; }
+
+        pending_wait *previous_;
+    };
+
+    inline auto handle(size_t index) const noexcept {
+        return static_cast<std::coroutine_handle<typename task_t::promise_type>>(slots_[index].task);
+    }
+
+    /* Moves a task out of the running ones, `position` being its position in `running_` */
+    inline void finish(size_t position) {
+        size_t index = running_[position];
+        running_[position] = running_.back();
+        running_.pop_back();
+        slots_[index].done = true;
+        if constexpr (order == delivery::completion_order) {
+            finished_.push_back(index);
+        }
+    }
+
+    std::optional<result_type> deliver() {
+        size_t index;
+        if constexpr (order == delivery::in_order) {
+            if (launched_.empty() || !slots_[launched_.front()].done) {
+                return std::nullopt;
+            }
+            index = launched_.front();
+            launched_.pop_front();
+        } else {
+            if (finished_.empty()) {
+                return std::nullopt;
+            }
+            index = finished_.front();
+            finished_.pop_front();
+        }
+        task_t task = std::move(slots_[index].task);
+        slots_[index].done = false;
+        free_.push_back(index);
+        if constexpr (std::is_void_v<value_type>) {
+            task.get();
+            return std::monostate{};
+        } else {
+            return std::move(*task.take());
+        }
+    }
+
+    std::vector<slot_t> slots_;
+    std::vector<size_t> free_;
+    std::vector<size_t> running_;
+    std::deque<size_t> launched_; // In order delivery
+    std::deque<size_t> finished_; // Completion order delivery
+};
+
+
+/**
+ * CPU stand-ins for device events, to drive pipelines without a GPU.
+ */
+class timer_event {
+public:
+    explicit timer_event(std::chrono::steady_clock::duration delay) : deadline_(std::chrono::steady_clock::now() + delay) {}
+
+    [[nodiscard]] inline bool is_complete() const noexcept { return std::chrono::steady_clock::now() >= deadline_; }
+
+private:
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+/* Runs `work` on its own thread, complete once it has returned. The last copy of the event joins the thread. */
+class thread_event {
+public:
+    template<std::invocable Work>
+    explicit thread_event(Work &&work) : state_(std::make_shared<state>()) {
+        state_->worker = std::thread([s = state_.get(), work = std::forward<Work>(work)]() mutable {
+            work();
+            s->done.store(true, std::memory_order_release);
+        });
+    }
+
+    [[nodiscard]] inline bool is_complete() const noexcept { return state_->done.load(std::memory_order_acquire); }
+
+private:
+    struct state {
+        std::atomic<bool> done{false};
+        std::thread worker;
+
+        ~state() {
+            if (worker.joinable()) worker.join();
+        }
+    };
+
+    std::shared_ptr<state> state_;
+};
+
+
+static constexpr void static_tests_event_pipeline() {
+    static_assert(pollable<timer_event>);
+    static_assert(pollable<thread_event>);
+    static_assert(!pollable<int>);
+    static_assert(sizeof(pending_wait) == 2 * sizeof(void *));
+}
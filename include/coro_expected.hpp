@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/**
+ * Error channel without exceptions: a coroutine returning an `expected<T, E>` reports failures with
+ * `co_return unexpected(err);` and its value_holder stores the value or the error code, nothing else.
+ * Use it with exceptions propagation disabled, `single_task<expected<T, E>>` or `generator<expected<T, E>, false>`:
+ * no exception_ptr, no throw and no rethrow on the failure path, the result is checked with has_value().
+ *
+ * A trimmed down std::expected (C++23): value() and error() do not check, reading the wrong one is undefined.
+ */
+template<typename E>
+struct unexpected {
+    E error;
+};
+
+template<typename E>
+unexpected(E) -> unexpected<E>;
+
+template<typename>
+struct is_unexpected : std::false_type {
+};
+
+template<typename E>
+struct is_unexpected<unexpected<E>> : std::true_type {
+};
+
+template<typename T, typename E = std::errc>
+class expected {
+    static_assert(!std::is_reference_v<T> && !is_unexpected<T>::value);
+
+public:
+    using value_type = T;
+    using error_type = E;
+
+    constexpr expected() requires(std::is_default_constructible_v<T>) = default;
+
+    template<typename U = T>
+    requires(std::is_constructible_v<T, U &&> && !std::is_same_v<std::remove_cvref_t<U>, expected> && !is_unexpected<std::remove_cvref_t<U>>::value)
+    constexpr expected(U &&val) : storage_(std::in_place_index<0>, std::forward<U>(val)) {}
+
+    template<typename G>
+    constexpr expected(const unexpected<G> &err) : storage_(std::in_place_index<1>, err.error) {}
+
+    [[nodiscard]] constexpr bool has_value() const noexcept { return storage_.index() == 0; }
+
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+
+    constexpr T &value() &noexcept { return *std::get_if<0>(&storage_); }
+
+    constexpr const T &value() const &noexcept { return *std::get_if<0>(&storage_); }
+
+    constexpr T &&value() &&noexcept { return std::move(*std::get_if<0>(&storage_)); }
+
+    constexpr T &operator*() &noexcept { return value(); }
+
+    constexpr const T &operator*() const &noexcept { return value(); }
+
+    constexpr T *operator->() noexcept { return &value(); }
+
+    constexpr const T *operator->() const noexcept { return &value(); }
+
+    constexpr const E &error() const noexcept { return *std::get_if<1>(&storage_); }
+
+    template<typename U>
+    constexpr T value_or(U &&fallback) const & { return has_value() ? value() : static_cast<T>(std::forward<U>(fallback)); }
+
+private:
+    std::variant<T, E> storage_;
+};
+
+template<typename E>
+class expected<void, E> {
+public:
+    using value_type = void;
+    using error_type = E;
+
+    constexpr expected() noexcept = default;
+
+    template<typename G>
+    constexpr expected(const unexpected<G> &err) : error_(err.error) {}
+
+    [[nodiscard]] constexpr bool has_value() const noexcept { return !error_.has_value(); }
+
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+
+    constexpr void value() const noexcept {}
+
+    constexpr const E &error() const noexcept { return *error_; }
+
+private:
+    std::optional<E> error_;
+};
+
+
+static constexpr void static_tests_expected() {
+    static_assert(sizeof(expected<int32_t, std::errc>) == 2 * sizeof(int32_t));
+    static_assert(sizeof(expected<void, uint16_t>) == 2 * sizeof(uint16_t));
+    static_assert(std::is_trivially_copyable_v<expected<int, std::errc>>);
+    constexpr expected<int> ok = 42;
+    constexpr expected<int> failed = unexpected(std::errc::invalid_argument);
+    static_assert(ok.has_value() && *ok == 42);
+    static_assert(!failed && failed.error() == std::errc::invalid_argument);
+}
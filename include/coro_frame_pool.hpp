@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * Thread-local recycling allocator for coroutine frames.
+ * Frame sizes are rounded up to a multiple of `granularity` bytes, and each size class has its own intrusive free list.
+ * A frame released on a thread goes to that thread's free list and the next frame of the same class reuses it, so
+ * creating and destroying short-lived coroutines never reaches malloc in steady state.
+ * Frames bigger than `max_pooled_size` are not cached and go straight to the global operator new.
+ */
+class frame_pool {
+public:
+    static constexpr size_t granularity = 64;
+    static constexpr size_t max_pooled_size = 2048;
+    static constexpr size_t class_count = max_pooled_size / granularity;
+    static constexpr size_t max_cached_per_class = 1024; // Bounds what a thread keeps when frames migrate across threads
+
+    static inline frame_pool &local() noexcept {
+        static thread_local frame_pool pool;
+        return pool;
+    }
+
+    [[nodiscard]] inline void *allocate(size_t size) {
+        if (size > max_pooled_size) {
+            return ::operator new(size);
+        }
+        auto &list = free_lists_[class_index(size)];
+        if (list.head) {
+            free_block *block = list.head;
+            list.head = block->next;
+            --list.count;
+            return block;
+        }
+        return ::operator new(class_size(size));
+    }
+
+    inline void deallocate(void *ptr, size_t size) noexcept {
+        if (size > max_pooled_size || released_ || free_lists_[class_index(size)].count >= max_cached_per_class) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto &list = free_lists_[class_index(size)];
+        list.head = ::new(ptr) free_block{list.head};
+        ++list.count;
+    }
+
+    /* Number of frames of the given size currently cached by this pool */
+    [[nodiscard]] inline size_t cached(size_t size) const noexcept {
+        return size > max_pooled_size ? 0 : free_lists_[class_index(size)].count;
+    }
+
+    /* Gives all the cached frames back to the global allocator */
+    void release() noexcept {
+        for (auto &list: free_lists_) {
+            while (list.head) {
+                ::operator delete(std::exchange(list.head, list.head->next));
+            }
+            list.count = 0;
+        }
+    }
+
+    frame_pool(const frame_pool &) = delete;
+
+    frame_pool &operator=(const frame_pool &) = delete;
+
+    ~frame_pool() {
+        release();
+        released_ = true; // Frames destroyed later on during the thread exit bypass the pool
+    }
+
+private:
+    frame_pool() = default;
+
+    static constexpr size_t class_index(size_t size) noexcept { return (size - 1) / granularity; }
+
+    static constexpr size_t class_size(size_t size) noexcept { return (class_index(size) + 1) * granularity; }
+
+    struct free_block {
+        free_block *next;
+    };
+
+    struct free_list {
+        free_block *head = nullptr;
+        size_t count = 0;
+    };
+
+    std::array<free_list, class_count> free_lists_{};
+    static inline thread_local bool released_ = false; // Trivially destructible, outlives the pool itself
+};
+
+
+/**
+ * Frame policies, inherited by the promise types. The compiler looks up the operator new/delete
+ * in the promise before falling back to the global ones.
+ */
+struct pooled_frames {
+    static void *operator new(size_t size) { return frame_pool::local().allocate(size); }
+
+    static void operator delete(void *ptr, size_t size) noexcept { frame_pool::local().deallocate(ptr, size); }
+};
+
+/**
+ * Opt-out: the frames go through the global operator new/delete.
+ */
+struct heap_frames {
+};
@@ -1,22 +1,63 @@
 #pragma once
 
 #include <helpers.hpp>
+#include <coro_frame_pool.hpp>
+#include <coro_trace.hpp>
 #include <coroutine>
+#include <iterator>
+#include <optional>
+#include <ranges>
 #include <string>
 #include <stdexcept>
+#include <utility>
 
 using namespace std::string_literals;
 
-template<typename T, bool enable_exceptions_propagation = true>
+/**
+ * Wraps a generator to yield all of its elements from a recursive generator: `co_yield elements_of(child());`
+ */
+template<typename range_t>
+struct elements_of {
+    range_t range;
+};
+
+template<typename range_t>
+elements_of(range_t &&) -> elements_of<range_t &&>;
+
+template<typename>
+struct is_elements_of : std::false_type {
+};
+
+template<typename range_t>
+struct is_elements_of<elements_of<range_t>> : std::true_type {
+};
+
+/**
+ * `frame_policy` selects where the coroutine frames come from and `instrumentation` whether they are traced, see
+ * single_task.
+ *
+ * A `recursive` generator can yield the elements of a child generator with `co_yield elements_of(child)`.
+ * The child is pushed on a stack of frames owned by the outermost generator, the root, which tracks the innermost
+ * one running, the leaf. The consumer resumes the leaf directly and reads the values from it, so each element costs
+ * the same whatever the nesting depth. When a child completes, it transfers control back to its parent.
+ *
+ * With a reference `T` (`generator<const record &>`), values are yielded by reference: the promise only keeps a
+ * pointer to the object, which must stay alive until the next resume, and the consumer reads it in place.
+ * get() and resume() then return a pointer, nullptr once done, instead of a copy in an optional.
+ */
+template<typename T, bool enable_exceptions_propagation = true, typename frame_policy = pooled_frames, bool recursive = false, typename instrumentation = untraced>
 struct generator {
 
     static_assert(!std::is_void_v<T>);
+
+    /* What get() and resume() return: a copy of the value, or a pointer to it when it is a reference or move-only */
+    using result_type = conditional_type_t<std::remove_reference_t<T> *, std::optional<T>, std::is_reference_v<T> || !std::is_copy_constructible_v<T>>;
 public:
     /**
      * The promise will be stored in the coroutine execution context along the variables,
      * registers, instruction pointer, parameters, all of the function state (lambdas too).
      */
-    struct generator_promise_type : value_holder<T, enable_exceptions_propagation> {
+    struct generator_promise_type : value_holder<T, enable_exceptions_propagation>, instrumentation::template frames<frame_policy>, instrumentation {
         using value_holder_t = value_holder<T, enable_exceptions_propagation>;
     public:
 
@@ -26,10 +67,16 @@ public:
         }
 
         /* Whether the coroutine suspends itself before it starts executing */
-        static constexpr auto initial_suspend() noexcept { return std::suspend_always{}; }
+        static constexpr auto initial_suspend() noexcept { return instrumentation::wrap(std::suspend_always{}); }
 
         /* Whether the coroutine suspends itself at the end before destruction. This is done to avoid the coroutine automatic destruction */
-        static constexpr auto final_suspend() noexcept { return std::suspend_always{}; }
+        static constexpr auto final_suspend() noexcept {
+            if constexpr (recursive) {
+                return instrumentation::template wrap<true>(final_awaiter{});
+            } else {
+                return instrumentation::template wrap<true>(std::suspend_always{});
+            }
+        }
 
         constexpr void unhandled_exception() noexcept {
             if constexpr(enable_exceptions_propagation) {
@@ -38,32 +85,102 @@ public:
         }
 
         template<typename U = T>
-        constexpr auto yield_value(U &&val) noexcept {
+        constexpr auto yield_value(U &&val) noexcept requires(!is_elements_of<std::remove_cvref_t<U>>::value) {
             value_holder_t::set_value(std::forward<U>(val));
-            return std::suspend_always{};
+            return instrumentation::wrap(std::suspend_always{});
         }
 
         template<typename U = T>
-        constexpr auto yield_value(const U &val) noexcept {
-            value_holder_t::set_value(std::forward<U>(val));
-            return std::suspend_always{};
+        constexpr auto yield_value(const U &val) noexcept requires(!is_elements_of<U>::value) {
+            value_holder_t::set_value(val);
+            return instrumentation::wrap(std::suspend_always{});
         }
 
         constexpr void return_void() const noexcept {}
+
+        /* Recursive mode: the parent suspends and the child runs until its first element */
+        template<typename range_t>
+        auto yield_value(elements_of<range_t> nested) noexcept requires(recursive) {
+            return instrumentation::wrap(nested_awaiter{nested.range});
+        }
+
+        struct nested_awaiter {
+            generator &child_;
+
+            [[nodiscard]] inline bool await_ready() const noexcept { return !child_.handle_ || child_.handle_.done(); }
+
+            inline std::coroutine_handle<> await_suspend(std::coroutine_handle<generator_promise_type> self) noexcept {
+                auto &parent = self.promise();
+                auto &nested = child_.handle_.promise();
+                nested.nesting_.parent = &parent;
+                nested.nesting_.root = parent.nesting_.root ? parent.nesting_.root : &parent;
+                nested.nesting_.root->nesting_.leaf = &nested;
+                return child_.handle_;
+            }
+
+            inline void await_resume() noexcept(!enable_exceptions_propagation) {
+                if constexpr (enable_exceptions_propagation) {
+                    if (!child_.handle_) return;
+                    if (auto ptr = child_.handle_.promise().get_exception_ptr()) {
+                        std::rethrow_exception(ptr);
+                    }
+                }
+            }
+        };
+
+        /* Returns to the parent when a nested generator completes */
+        struct final_awaiter {
+            static constexpr bool await_ready() noexcept { return false; }
+
+            inline std::coroutine_handle<> await_suspend(std::coroutine_handle<generator_promise_type> self) const noexcept {
+                auto &nesting = self.promise().nesting_;
+                if (!nesting.parent) {
+                    return std::noop_coroutine();
+                }
+                nesting.root->nesting_.leaf = nesting.parent == nesting.root ? nullptr : nesting.parent;
+                return std::coroutine_handle<generator_promise_type>::from_promise(*nesting.parent);
+            }
+
+            static constexpr void await_resume() noexcept {}
+        };
+
+        /* The promise producing the current value */
+        inline generator_promise_type &active() noexcept {
+            if constexpr (recursive) {
+                return nesting_.leaf ? *nesting_.leaf : *this;
+            } else {
+                return *this;
+            }
+        }
+
+        struct nesting_links {
+            generator_promise_type *parent = nullptr;
+            generator_promise_type *root = nullptr; // nullptr in the root itself
+            generator_promise_type *leaf = nullptr; // Only meaningful in the root, nullptr when the root is running
+        };
+
+        [[no_unique_address]] optional_type_t<nesting_links, recursive> nesting_;
     };
 
     using promise_type = generator_promise_type;
 
 public:
-    struct iterator : std::iterator<std::input_iterator_tag, T> {
-        iterator(std::coroutine_handle<generator_promise_type> handle = nullptr) : it_handle_(handle) {}
+    /**
+     * Input iterator, equal to end(), or to std::default_sentinel, once the generator is exhausted: the end test only
+     * checks the handle for null. The range is common, so that it also works with the iterator pairs of <algorithm>
+     * and <numeric>, and `generator` models std::ranges::input_range.
+     */
+    struct iterator {
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = std::remove_cvref_t<T>;
+        using reference = T const &;
 
-        //using iterator_concept = std::input_iterator_tag;
-        //using difference_type = ptrdiff_t;
-        //using value_type = std::remove_cvref_t<T>;
+        iterator(std::coroutine_handle<generator_promise_type> handle = nullptr) : it_handle_(handle) {}
 
         inline iterator &operator++() noexcept(!enable_exceptions_propagation) {
-            if (it_handle_ && !it_handle_.done())it_handle_.resume();
+            if (it_handle_ && !it_handle_.done()) resume_active(it_handle_);
             if constexpr(enable_exceptions_propagation) {
                 rethrow_exceptions();
             }
@@ -71,7 +188,10 @@ public:
             return *this;
         }
 
-        inline void rethrow_exceptions() noexcept(!enable_exceptions_propagation) requires(enable_exceptions_propagation)  {
+        inline void operator++(int) noexcept(!enable_exceptions_propagation) { ++*this; }
+
+        /* Forgets the handle when rethrowing, the iterator then compares equal to the end */
+        inline void rethrow_exceptions() const requires(enable_exceptions_propagation) {
             if (!it_handle_) {
                 throw std::runtime_error("Called coroutine on empty/destroyed handle"s);
             }
@@ -81,26 +201,34 @@ public:
             }
         }
 
-        inline T const &operator*() noexcept(!enable_exceptions_propagation) {
-            rethrow_exceptions();
-            return it_handle_.promise().get_value();
+        inline T const &operator*() const noexcept(!enable_exceptions_propagation) {
+            if constexpr(enable_exceptions_propagation) {
+                rethrow_exceptions();
+            }
+            return it_handle_.promise().active().get_value();
+        }
+
+        friend constexpr bool operator==(const iterator &a, const iterator &b) noexcept {
+            return a.it_handle_ == b.it_handle_;
         }
 
-        constexpr bool operator!=(const iterator &other) const noexcept {
-            return it_handle_ != other.it_handle_;
+        friend constexpr bool operator==(const iterator &it, std::default_sentinel_t) noexcept {
+            return !it.it_handle_;
         }
 
     private:
-        std::coroutine_handle<generator_promise_type> it_handle_;
+        mutable std::coroutine_handle<generator_promise_type> it_handle_;
 
     };
 
     iterator begin() noexcept(!enable_exceptions_propagation) {
         if (handle_) {
-            handle_.resume();
-            rethrow_exceptions();
+            resume_active(handle_);
+            if constexpr(enable_exceptions_propagation) {
+                rethrow_exceptions();
+            }
             if (done()) {
-                return end();
+                return {};
             }
         }
         return iterator(handle_);
@@ -120,6 +248,10 @@ public:
     }
 
 private:
+    static inline void resume_active(std::coroutine_handle<generator_promise_type> root) {
+        std::coroutine_handle<generator_promise_type>::from_promise(root.promise().active()).resume();
+    }
+
     void rethrow_exceptions() requires(enable_exceptions_propagation){
         if (!handle_) {
             throw std::runtime_error("Called coroutine on empty/destroyed handle"s);
@@ -131,27 +263,31 @@ private:
     }
 
 public:
-    std::optional<T> get() noexcept(!enable_exceptions_propagation) {
+    result_type get() noexcept(!enable_exceptions_propagation) {
         if constexpr (enable_exceptions_propagation) {
             rethrow_exceptions();
         }
         if (handle_ && !handle_.done()) {
-            return handle_.promise().get_value();
+            if constexpr (std::is_pointer_v<result_type>) {
+                return std::addressof(handle_.promise().active().get_value());
+            } else {
+                return handle_.promise().active().get_value();
+            }
         } else {
-            return std::nullopt;
+            return result_type{};
         }
 
     }
 
-    std::optional<T> resume() noexcept(!enable_exceptions_propagation) {
+    result_type resume() noexcept(!enable_exceptions_propagation) {
         if constexpr (enable_exceptions_propagation) {
             rethrow_exceptions();
         }
         if (handle_ && !handle_.done()) {
-            handle_.resume();
+            resume_active(handle_);
             return get();
         } else {
-            return std::nullopt;
+            return result_type{};
         }
     }
 
@@ -159,6 +295,18 @@ public:
         return resume();
     }
 
+    /* Moves the current value out, std::nullopt once done. Until the next resume, the value left is moved-from. */
+    std::optional<T> take() noexcept(!enable_exceptions_propagation) requires(!std::is_reference_v<T>) {
+        if constexpr (enable_exceptions_propagation) {
+            rethrow_exceptions();
+        }
+        if (handle_ && !handle_.done()) {
+            return std::move(handle_.promise().active().get_value());
+        } else {
+            return std::nullopt;
+        }
+    }
+
 public:
     operator std::coroutine_handle<generator_promise_type>() const { return handle_; }
 
@@ -178,6 +326,7 @@ public:
 
     generator &operator=(generator &&other) noexcept {
         if (&other != this) {
+            destroy();
             handle_ = std::exchange(other.handle_, nullptr);
         }
         return *this;
@@ -187,6 +336,8 @@ public:
         destroy();
     }
 
+    friend struct generator_promise_type;
+
 
 private:
     std::coroutine_handle<generator_promise_type> handle_;
@@ -194,11 +345,25 @@ private:
 };
 
 
+template<typename T, bool enable_exceptions_propagation = true, typename frame_policy = pooled_frames, typename instrumentation = untraced>
+using recursive_generator = generator<T, enable_exceptions_propagation, frame_policy, true, instrumentation>;
+
+
 static constexpr void static_tests_coroutine_generator() {
     static_assert(sizeof(generator<int, true>) == sizeof(std::coroutine_handle<void>));
     static_assert(sizeof(generator<int, false>) == sizeof(std::coroutine_handle<void>));
 
     static_assert(sizeof(generator<int, false>::promise_type) == sizeof(int));
     static_assert(sizeof(generator<int, true>::promise_type) == sizeof(std::variant<int, std::exception_ptr>));
+    static_assert(sizeof(generator<int, false, heap_frames>::promise_type) == sizeof(int));
+    static_assert(sizeof(generator<int, false, pooled_frames, true>::promise_type) == 4 * sizeof(void *));
+    static_assert(sizeof(generator<const std::string &, false>::promise_type) == sizeof(void *));
+    static_assert(std::is_same_v<decltype(std::declval<generator<const std::string &>>().get()), const std::string *>);
+
+    static_assert(std::ranges::input_range<generator<int>>);
+    static_assert(std::ranges::input_range<generator<const std::string &, false>>);
+    static_assert(std::ranges::input_range<generator<int, true, pooled_frames, true>>);
+    static_assert(std::ranges::viewable_range<generator<int>>);
+    static_assert(std::ranges::common_range<generator<int>>);
 
 }
\ No newline at end of file
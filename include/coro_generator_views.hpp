@@ -0,0 +1,227 @@
+#pragma once
+
+#include <coro_generator.hpp>
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Pipeline adaptors for generators: `gen | fused::transform(f) | fused::filter(p) | fused::take(n)`.
+ *
+ * Stacking one generator per stage costs a frame and a resume per element and per stage. Here the stages are
+ * nested in a single view that pulls from the source generator and runs them inline, so the whole pipeline has the
+ * source's frame only and resumes it once per element. The stages are plain function objects that the compiler
+ * sees through and inlines into the consumer's loop.
+ *
+ * The source can be any input range, held by reference when it is an lvalue and moved into the view otherwise.
+ * The views are single pass. Once iterated they must not move, as the iterator points to them.
+ */
+namespace fused {
+
+    /* Base of the adapted views, which chain further stages by being moved into them */
+    struct view_tag {
+    };
+
+    template<typename node_t>
+    concept node = std::derived_from<std::remove_cvref_t<node_t>, view_tag>;
+
+    /**
+     * Each ++ pulls the next value through all the stages. Equal to std::default_sentinel once exhausted.
+     */
+    template<typename node_t>
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type = ptrdiff_t;
+        using value_type = std::remove_cvref_t<decltype(std::declval<node_t &>().value())>;
+
+        iterator() = default;
+
+        explicit iterator(node_t *node) : node_(node), done_(!node->template next<true>()) {}
+
+        inline iterator &operator++() {
+            done_ = !node_->next();
+            return *this;
+        }
+
+        inline void operator++(int) { ++*this; }
+
+        inline decltype(auto) operator*() const { return node_->value(); }
+
+        friend constexpr bool operator==(const iterator &it, std::default_sentinel_t) noexcept { return it.done_; }
+
+    private:
+        node_t *node_ = nullptr;
+        bool done_ = true;
+    };
+
+    /**
+     * Gives every view its begin() and end(), the views only implement next() and value().
+     * `next<true>()` is called once from begin(), it starts the source instead of advancing it.
+     */
+    template<typename node_t>
+    struct view_base : view_tag {
+        inline iterator<node_t> begin() { return iterator<node_t>(static_cast<node_t *>(this)); }
+
+        static constexpr std::default_sentinel_t end() noexcept { return {}; }
+    };
+
+    template<typename range_t>
+    class source : public view_base<source<range_t>> {
+    public:
+        explicit source(range_t &&range) : range_(std::forward<range_t>(range)) {}
+
+        template<bool first = false>
+        inline bool next() {
+            if constexpr (first) {
+                it_ = std::ranges::begin(range_);
+            } else {
+                ++it_;
+            }
+            return it_ != std::ranges::end(range_);
+        }
+
+        inline decltype(auto) value() { return *it_; }
+
+    private:
+        range_t range_;
+        std::ranges::iterator_t<std::remove_reference_t<range_t>> it_{};
+    };
+
+    template<typename prev_t, typename F>
+    class transform_view : public view_base<transform_view<prev_t, F>> {
+        using result_t = std::remove_cvref_t<std::invoke_result_t<F &, decltype(std::declval<prev_t &>().value())>>;
+    public:
+        transform_view(prev_t &&prev, F f) : prev_(std::move(prev)), f_(std::move(f)) {}
+
+        /* The result is computed once, however many times it is read, so that later stages do not call `f` again */
+        template<bool first = false>
+        inline bool next() {
+            if (!prev_.template next<first>()) {
+                return false;
+            }
+            current_.emplace(std::invoke(f_, prev_.value()));
+            return true;
+        }
+
+        inline result_t &value() { return *current_; }
+
+    private:
+        prev_t prev_;
+        F f_;
+        std::optional<result_t> current_;
+    };
+
+    template<typename prev_t, typename Pred>
+    class filter_view : public view_base<filter_view<prev_t, Pred>> {
+    public:
+        filter_view(prev_t &&prev, Pred pred) : prev_(std::move(prev)), pred_(std::move(pred)) {}
+
+        template<bool first = false>
+        inline bool next() {
+            if (!prev_.template next<first>()) {
+                return false;
+            }
+            do {
+                if (std::invoke(pred_, std::as_const(prev_.value()))) {
+                    return true;
+                }
+            } while (prev_.next());
+            return false;
+        }
+
+        inline decltype(auto) value() { return prev_.value(); }
+
+    private:
+        prev_t prev_;
+        Pred pred_;
+    };
+
+    /* Stops pulling from the source after `count` values, the generator is not resumed any further */
+    template<typename prev_t>
+    class take_view : public view_base<take_view<prev_t>> {
+    public:
+        take_view(prev_t &&prev, size_t count) : prev_(std::move(prev)), remaining_(count) {}
+
+        template<bool first = false>
+        inline bool next() {
+            if (remaining_ == 0) {
+                return false;
+            }
+            --remaining_;
+            return prev_.template next<first>();
+        }
+
+        inline decltype(auto) value() { return prev_.value(); }
+
+    private:
+        prev_t prev_;
+        size_t remaining_;
+    };
+
+    /**
+     * Pipeable stages, each one wraps the view on its left
+     */
+    template<typename F>
+    struct transform_stage {
+        F f;
+
+        template<typename prev_t>
+        inline auto wrap(prev_t &&prev) && { return transform_view<prev_t, F>(std::move(prev), std::move(f)); }
+    };
+
+    template<typename Pred>
+    struct filter_stage {
+        Pred pred;
+
+        template<typename prev_t>
+        inline auto wrap(prev_t &&prev) && { return filter_view<prev_t, Pred>(std::move(prev), std::move(pred)); }
+    };
+
+    struct take_stage {
+        size_t count;
+
+        template<typename prev_t>
+        inline auto wrap(prev_t &&prev) && { return take_view<prev_t>(std::move(prev), count); }
+    };
+
+    template<typename F>
+    inline transform_stage<F> transform(F f) { return {std::move(f)}; }
+
+    template<typename Pred>
+    inline filter_stage<Pred> filter(Pred pred) { return {std::move(pred)}; }
+
+    inline take_stage take(size_t count) { return {count}; }
+
+    template<typename stage_t>
+    concept stage = requires(stage_t &&s, source<std::ranges::empty_view<int>> &&prev) {
+        { std::move(s).wrap(std::move(prev)) } -> node;
+    };
+
+    /* Views are moved into the next stage */
+    template<node node_t, stage stage_t>
+    requires(!std::is_lvalue_reference_v<node_t>)
+    inline auto operator|(node_t &&prev, stage_t s) {
+        return std::move(s).wrap(std::move(prev));
+    }
+
+    template<std::ranges::input_range range_t, stage stage_t>
+    requires(!node<range_t>)
+    inline auto operator|(range_t &&range, stage_t s) {
+        return std::move(s).wrap(source<range_t>(std::forward<range_t>(range)));
+    }
+}
+
+
+static constexpr void static_tests_generator_views() {
+    using pipeline_t = decltype(std::declval<generator<int> &>() | fused::transform([](int i) { return i * 2; }) | fused::take(3));
+    static_assert(std::ranges::input_range<pipeline_t>);
+    static_assert(std::is_same_v<std::ranges::range_value_t<pipeline_t>, int>);
+    static_assert(sizeof(fused::source<generator<int> &>) == 2 * sizeof(void *));
+}
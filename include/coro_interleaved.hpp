@@ -0,0 +1,330 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+#include <coro_task_group.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Batched lookups in data structures larger than the caches. Each lookup is a coroutine that prefetches the next
+ * memory location it needs and suspends, and a task_group keeps `width` of them in flight: while one lookup waits
+ * for its cache miss, the others make progress, so the misses overlap instead of being paid one after the other.
+ *
+ * Results come in the order of the keys. Worth it once the structure does not fit in the last level cache, below
+ * that the scalar loops are faster.
+ */
+
+/**
+ * `co_await prefetchable(ptr);` issues a prefetch of `ptr` and suspends, the scheduler resumes the task later on.
+ * The default hint is non-temporal, for data read once. Searches that share their first steps (the top of a tree, the
+ * middle of an array) keep the lines in all the cache levels with `locality = 3`.
+ */
+template<typename T, int locality = 0>
+struct prefetchable : std::suspend_always {
+    prefetchable(const T *ptr) { __builtin_prefetch((const void *) (ptr), 0, locality); }
+};
+
+namespace interleaved_detail {
+
+    template<typename T>
+    using lookup_task = single_task<T, true, false>;
+
+    /* The lookups of a batch share their first steps */
+    template<typename T>
+    inline prefetchable<T, 3> prefetch(const T *ptr) { return {ptr}; }
+
+    template<size_t width, typename keys_t, typename result_t, typename Factory>
+    inline std::vector<result_t> run_lookups(keys_t &&keys, Factory &&make_task) {
+        static_assert(width > 0 && width <= 64);
+        std::vector<result_t> results;
+        if constexpr (std::ranges::sized_range<keys_t>) {
+            results.resize(static_cast<size_t>(std::ranges::size(keys)));
+        }
+        auto group = task_group<lookup_task<result_t>, width>{};
+        group.run(keys, std::forward<Factory>(make_task), [&](size_t index, result_t result) {
+            if constexpr (!std::ranges::sized_range<keys_t>) {
+                if (index >= results.size()) results.resize(index + 1); // Results come out of order
+            }
+            results[index] = result;
+        });
+        return results;
+    }
+
+    /* Branchless binary search: the only branch left is the loop, whose trip count only depends on the size */
+    template<typename T, typename K, typename Compare>
+    inline size_t lower_bound(const T *first, size_t size, const K &key, Compare &comp) {
+        if (size == 0) {
+            return 0;
+        }
+        const T *base = first;
+        while (size > 1) {
+            size_t half = size / 2;
+            base = comp(base[half], key) ? base + half : base;
+            size -= half;
+        }
+        return static_cast<size_t>(base - first) + comp(*base, key);
+    }
+
+    template<typename T, typename K, typename Compare>
+    lookup_task<size_t> lower_bound_task(const T *first, size_t size, K key, Compare &comp) {
+        if (size == 0) {
+            co_return 0;
+        }
+        const T *base = first;
+        while (size > 1) {
+            size_t half = size / 2;
+            co_await prefetch(base + half);
+            base = comp(base[half], key) ? base + half : base;
+            size -= half;
+        }
+        co_return static_cast<size_t>(base - first) + comp(*base, key);
+    }
+}
+
+
+/**
+ * Open addressing hash table with linear probing, the probed slots of a key are next to each other so that once
+ * the first one is in cache the probe runs without further misses. At most half full.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class open_addressing_table {
+public:
+    struct slot {
+        K key;
+        V value;
+        bool occupied;
+    };
+
+    explicit open_addressing_table(size_t max_size, Hash hash = {})
+            : slots_(std::bit_ceil(std::max<size_t>(2 * max_size, 2))), mask_(slots_.size() - 1), hash_(std::move(hash)) {}
+
+    /* Returns false if the key was already there, its value is left as is */
+    bool insert(const K &key, V value) {
+        if (2 * (size_ + 1) > slots_.size()) {
+            throw std::length_error("open_addressing_table is full");
+        }
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            auto &s = slots_[i];
+            if (!s.occupied) {
+                s = slot{key, std::move(value), true};
+                ++size_;
+                return true;
+            }
+            if (s.key == key) {
+                return false;
+            }
+        }
+    }
+
+    /* nullptr if the key is absent */
+    [[nodiscard]] inline const V *find(const K &key) const { return probe(home(key), key); }
+
+    /* Index of the first slot probed for `key` */
+    [[nodiscard]] inline size_t home(const K &key) const { return hash_(key) & mask_; }
+
+    [[nodiscard]] inline const slot *slot_at(size_t index) const noexcept { return &slots_[index]; }
+
+    /* Linear probe from slot `index` */
+    [[nodiscard]] inline const V *probe(size_t index, const K &key) const {
+        for (;; index = (index + 1) & mask_) {
+            const auto &s = slots_[index];
+            if (!s.occupied) {
+                return nullptr;
+            }
+            if (s.key == key) {
+                return &s.value;
+            }
+        }
+    }
+
+    [[nodiscard]] inline size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] inline size_t slot_count() const noexcept { return slots_.size(); }
+
+private:
+    std::vector<slot> slots_;
+    size_t mask_;
+    size_t size_ = 0;
+    [[no_unique_address]] Hash hash_;
+};
+
+
+/**
+ * Read-only B+tree bulk loaded from sorted unique keys. Nodes are one cache line: `node_keys` keys, their count and
+ * the index of their first child, the children of a node being next to each other on the level below. The leaves
+ * are the keys themselves and the values are stored apart, in key order, so that the descent only touches keys.
+ * A lookup costs one cache line per level.
+ */
+template<typename K, typename V, size_t node_keys = std::max<size_t>(1, (64 - 2 * sizeof(uint32_t)) / sizeof(K))>
+class bplus_tree {
+public:
+    struct alignas(64) node {
+        std::array<K, node_keys> keys;
+        uint32_t count;
+        uint32_t first_child;
+    };
+
+    bplus_tree(std::vector<K> keys, std::vector<V> values) : values_(std::move(values)) {
+        if (keys.size() != values_.size()) {
+            throw std::invalid_argument("bplus_tree needs as many keys as values");
+        }
+        if (!std::is_sorted(keys.begin(), keys.end()) || std::adjacent_find(keys.begin(), keys.end()) != keys.end()) {
+            throw std::invalid_argument("bplus_tree keys must be sorted and unique");
+        }
+        if (keys.empty()) {
+            return;
+        }
+
+        /* Leaves: the keys by chunks of `node_keys`, all full but the last one */
+        std::vector<node> leaves((keys.size() + node_keys - 1) / node_keys);
+        std::vector<K> lowest(leaves.size()); // Smallest key below each node of the level being built
+        for (size_t l = 0; l < leaves.size(); ++l) {
+            size_t begin = l * node_keys, end = std::min(begin + node_keys, keys.size());
+            std::copy(keys.begin() + static_cast<ptrdiff_t>(begin), keys.begin() + static_cast<ptrdiff_t>(end), leaves[l].keys.begin());
+            leaves[l].count = static_cast<uint32_t>(end - begin);
+            leaves[l].first_child = 0;
+            lowest[l] = keys[begin];
+        }
+        levels_.push_back(std::move(leaves));
+
+        /* Internal nodes: up to `node_keys + 1` children each, separated by the smallest key of all but the first */
+        while (levels_.back().size() > 1) {
+            size_t children = levels_.back().size();
+            std::vector<node> level((children + node_keys) / (node_keys + 1));
+            std::vector<K> level_lowest(level.size());
+            for (size_t n = 0; n < level.size(); ++n) {
+                size_t first = n * (node_keys + 1), last = std::min(first + node_keys + 1, children);
+                level[n].first_child = static_cast<uint32_t>(first);
+                level[n].count = static_cast<uint32_t>(last - first - 1);
+                for (size_t c = first + 1; c < last; ++c) {
+                    level[n].keys[c - first - 1] = lowest[c];
+                }
+                level_lowest[n] = lowest[first];
+            }
+            levels_.push_back(std::move(level));
+            lowest = std::move(level_lowest);
+        }
+        std::reverse(levels_.begin(), levels_.end()); // Root first
+    }
+
+    /* nullptr if the key is absent */
+    [[nodiscard]] const V *find(const K &key) const {
+        if (empty()) {
+            return nullptr;
+        }
+        const node *current = root();
+        for (size_t level = 0; level + 1 < height(); ++level) {
+            current = child(level, current, key);
+        }
+        return find_in_leaf(current, key);
+    }
+
+    [[nodiscard]] inline bool empty() const noexcept { return levels_.empty(); }
+
+    /* Number of levels, leaves included */
+    [[nodiscard]] inline size_t height() const noexcept { return levels_.size(); }
+
+    [[nodiscard]] inline const node *root() const noexcept { return levels_.front().data(); }
+
+    /* Child of `parent`, a node of `level`, to descend into for `key` */
+    [[nodiscard]] inline const node *child(size_t level, const node *parent, const K &key) const {
+        uint32_t c = 0;
+        for (uint32_t k = 0; k < parent->count; ++k) {
+            c += !(key < parent->keys[k]);
+        }
+        return &levels_[level + 1][parent->first_child + c];
+    }
+
+    [[nodiscard]] inline const V *find_in_leaf(const node *leaf, const K &key) const {
+        for (uint32_t k = 0; k < leaf->count; ++k) {
+            if (leaf->keys[k] == key) {
+                return &values_[static_cast<size_t>(leaf - levels_.back().data()) * node_keys + k];
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    std::vector<std::vector<node>> levels_;
+    std::vector<V> values_;
+};
+
+
+/**
+ * Position of the first element of `sorted` not less than each key, like std::lower_bound.
+ */
+template<size_t width = 16, std::ranges::contiguous_range sorted_t, std::ranges::input_range keys_t, typename Compare = std::less<>>
+std::vector<size_t> interleaved_lower_bound(const sorted_t &sorted, keys_t &&keys, Compare comp = {}) {
+    const auto *first = std::ranges::data(sorted);
+    auto size = static_cast<size_t>(std::ranges::size(sorted));
+    return interleaved_detail::run_lookups<width, keys_t, size_t>(std::forward<keys_t>(keys), [&](const auto &key) {
+        return interleaved_detail::lower_bound_task(first, size, key, comp);
+    });
+}
+
+/* Scalar version, one search after the other */
+template<std::ranges::contiguous_range sorted_t, std::ranges::input_range keys_t, typename Compare = std::less<>>
+std::vector<size_t> scalar_lower_bound(const sorted_t &sorted, keys_t &&keys, Compare comp = {}) {
+    const auto *first = std::ranges::data(sorted);
+    auto size = static_cast<size_t>(std::ranges::size(sorted));
+    std::vector<size_t> results;
+    for (const auto &key: keys) {
+        results.push_back(interleaved_detail::lower_bound(first, size, key, comp));
+    }
+    return results;
+}
+
+
+/**
+ * Value of each key in `table`, nullptr for the absent ones.
+ * A probe is a single miss that does not depend on the previous one, so the out-of-order core already overlaps
+ * consecutive scalar probes when the loop body is small: interleaving pays off when the caller does more per key.
+ */
+template<size_t width = 16, typename K, typename V, typename Hash, std::ranges::input_range keys_t>
+std::vector<const V *> interleaved_hash_probe(const open_addressing_table<K, V, Hash> &table, keys_t &&keys) {
+    return interleaved_detail::run_lookups<width, keys_t, const V *>(std::forward<keys_t>(keys), [&](const K &key) {
+        return [](const open_addressing_table<K, V, Hash> &table, K key) -> interleaved_detail::lookup_task<const V *> {
+            size_t index = table.home(key);
+            co_await interleaved_detail::prefetch(table.slot_at(index));
+            co_return table.probe(index, key);
+        }(table, key);
+    });
+}
+
+
+/**
+ * Value of each key in `tree`, nullptr for the absent ones.
+ */
+template<size_t width = 16, typename K, typename V, size_t node_keys, std::ranges::input_range keys_t>
+std::vector<const V *> interleaved_tree_find(const bplus_tree<K, V, node_keys> &tree, keys_t &&keys) {
+    return interleaved_detail::run_lookups<width, keys_t, const V *>(std::forward<keys_t>(keys), [&](const K &key) {
+        return [](const bplus_tree<K, V, node_keys> &tree, K key) -> interleaved_detail::lookup_task<const V *> {
+            if (tree.empty()) {
+                co_return nullptr;
+            }
+            const auto *current = tree.root();
+            for (size_t level = 0; level + 1 < tree.height(); ++level) {
+                current = tree.child(level, current, key);
+                co_await interleaved_detail::prefetch(current);
+            }
+            co_return tree.find_in_leaf(current, key);
+        }(tree, key);
+    });
+}
+
+
+static constexpr void static_tests_interleaved() {
+    static_assert(sizeof(bplus_tree<uint64_t, uint64_t>::node) == 64);
+    static_assert(sizeof(bplus_tree<uint32_t, uint32_t>::node) == 64);
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <coro_event_pipeline.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define CORO_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#else
+#define CORO_HAS_IO_URING 0
+#endif
+
+enum class io_backend {
+    io_uring, // Linux io_uring: the operations are queued, submitted in batches and completed asynchronously
+    blocking // pread/pwrite in place, the awaiting coroutine does not suspend
+};
+
+/**
+ * A read or write in flight. The ring fills in the result, a byte count or -errno, then resumes the coroutine
+ * waiting on it, if any: in an event_pipeline, the pipeline polls the operation and resumes the task itself.
+ */
+struct io_operation {
+    std::coroutine_handle<> waiting_{};
+    int32_t result_ = 0;
+    bool completed_ = false;
+};
+
+/**
+ * Submission and completion rings of one thread, io_ring::local() being the one of the calling thread.
+ *
+ * Awaiting an operation only queues it: the queued operations are handed to the kernel together, with a single
+ * system call, when the thread polls or waits on the ring, or when the submission ring is full. Completions are
+ * reaped in bulk from the shared completion ring, without system call, and each one resumes its coroutine.
+ * The thread that awaits an operation has to drive its ring: wait() or run() until its coroutines are done.
+ *
+ * When io_uring is not available (not Linux, kernel older than 5.6, forbidden by a sandbox...), the ring falls back
+ * to blocking pread/pwrite and never suspends anything. Destroy a ring once idle, the buffers of operations in flight
+ * would be written to after their coroutine is gone.
+ */
+class io_ring {
+public:
+    static constexpr unsigned default_entries = 256;
+
+    explicit io_ring(unsigned entries = default_entries, io_backend backend = io_backend::io_uring) : backend_(io_backend::blocking) {
+#if CORO_HAS_IO_URING
+        if (backend == io_backend::io_uring && setup(entries)) {
+            backend_ = io_backend::io_uring;
+        }
+#else
+        (void) entries;
+        (void) backend;
+#endif
+    }
+
+    io_ring(const io_ring &) = delete;
+
+    io_ring &operator=(const io_ring &) = delete;
+
+    ~io_ring() {
+#if CORO_HAS_IO_URING
+        teardown();
+#endif
+    }
+
+    static inline io_ring &local() {
+        static thread_local io_ring ring;
+        return ring;
+    }
+
+    [[nodiscard]] inline io_backend backend() const noexcept { return backend_; }
+
+    /* Operations queued or submitted and not reaped yet */
+    [[nodiscard]] inline size_t in_flight() const noexcept { return in_flight_; }
+
+    /* Number of io_uring_enter calls so far */
+    [[nodiscard]] inline uint64_t enter_calls() const noexcept { return enter_calls_; }
+
+    /* Submits the queued operations and resumes the coroutines of those completed, without waiting */
+    size_t poll() {
+#if CORO_HAS_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            if (queued()) {
+                enter(0);
+            }
+            return reap();
+        }
+#endif
+        return 0;
+    }
+
+    /* Like poll(), but waits for a completion if there is none yet and something is in flight */
+    size_t wait() {
+#if CORO_HAS_IO_URING
+        if (backend_ == io_backend::io_uring && in_flight_ > 0) {
+            if (queued() || !completions_ready()) {
+                enter(completions_ready() ? 0 : 1);
+            }
+            return reap();
+        }
+#endif
+        return 0;
+    }
+
+    /* Waits until nothing is in flight anymore */
+    void run() {
+        while (in_flight_ > 0) {
+            wait();
+        }
+    }
+
+    /**
+     * Queues a read (or a write) of `size` bytes at `offset`, completing `op`. Blocking backend: performs it right
+     * away and completes `op` before returning.
+     */
+    void queue(io_operation &op, bool write, int fd, void *data, size_t size, uint64_t offset) {
+        size = std::min<size_t>(size, max_transfer);
+#if CORO_HAS_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            auto &sqe = next_sqe();
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<uint64_t>(data);
+            sqe.len = static_cast<uint32_t>(size);
+            sqe.off = offset;
+            sqe.user_data = reinterpret_cast<uint64_t>(&op);
+            ++in_flight_;
+            return;
+        }
+#endif
+        ssize_t result;
+        do {
+            result = write ? ::pwrite(fd, data, size, static_cast<off_t>(offset)) : ::pread(fd, data, size, static_cast<off_t>(offset));
+        } while (result < 0 && errno == EINTR);
+        op.result_ = result < 0 ? -errno : static_cast<int32_t>(result);
+        op.completed_ = true;
+    }
+
+private:
+    static constexpr size_t max_transfer = 0x7ffff000; // What a single read() transfers at most on Linux
+
+    io_backend backend_;
+    size_t in_flight_ = 0;
+    uint64_t enter_calls_ = 0;
+
+#if CORO_HAS_IO_URING
+    bool setup(unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, std::max(entries, 1U), &params));
+        if (fd_ < 0) {
+            return false;
+        }
+        if (!supports_read_write()) {
+            teardown();
+            return false;
+        }
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = map(sqes_size_, IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            sqes_ = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes);
+            teardown();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        auto *sq = static_cast<char *>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        auto *sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i) {
+            sq_array[i] = i; // Slot i always holds sqe i
+        }
+        sqe_tail_ = *sq_tail_;
+
+        auto *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    /* Linux 5.1 to 5.5 set rings up but reject IORING_OP_READ/WRITE: both came with 5.6, as the probe did */
+    [[nodiscard]] bool supports_read_write() const noexcept {
+        constexpr unsigned op_count = std::max(IORING_OP_READ, IORING_OP_WRITE) + 1;
+        alignas(io_uring_probe) std::byte buffer[sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op)]{};
+        auto *probe = reinterpret_cast<io_uring_probe *>(buffer);
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, op_count) < 0) {
+            return false;
+        }
+        auto supported = [probe](unsigned op) { return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED); };
+        return supported(IORING_OP_READ) && supported(IORING_OP_WRITE);
+    }
+
+    void teardown() noexcept {
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+        if (fd_ >= 0) close(fd_);
+        sqes_ = nullptr;
+        cq_ring_ = sq_ring_ = MAP_FAILED;
+        fd_ = -1;
+    }
+
+    inline void *map(size_t size, off_t offset) const noexcept {
+        return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    }
+
+    /* Queued and not consumed by the kernel yet */
+    [[nodiscard]] inline unsigned queued() const noexcept {
+        return sqe_tail_ - std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] inline bool completions_ready() const noexcept {
+        return std::atomic_ref(*cq_head_).load(std::memory_order_relaxed) != std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+    }
+
+    inline io_uring_sqe &next_sqe() {
+        while (queued() >= sq_entries_) {
+            enter(0); // Full: hands the batch over
+            if (queued() >= sq_entries_) {
+                reap();
+            }
+        }
+        return sqes_[sqe_tail_++ & sq_mask_];
+    }
+
+    /* Publishes the queued entries and submits them, waiting for `min_complete` completions */
+    void enter(unsigned min_complete) {
+        std::atomic_ref(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+        while (true) {
+            ++enter_calls_;
+            auto flags = min_complete ? IORING_ENTER_GETEVENTS : 0U;
+            if (syscall(__NR_io_uring_enter, fd_, queued(), min_complete, flags, nullptr, 0) >= 0) {
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN || errno == EBUSY) && completions_ready()) {
+                return; // Out of resources until the completions are reaped
+            }
+            throw std::system_error(errno, std::system_category(), "io_uring_enter");
+        }
+    }
+
+    /* Completes the operations of the completion ring, in bulk. A coroutine resumed from here may queue more. */
+    size_t reap() {
+        size_t reaped = 0;
+        auto head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+        while (head != std::atomic_ref(*cq_tail_).load(std::memory_order_acquire)) {
+            auto &cqe = cqes_[head & cq_mask_];
+            auto *op = reinterpret_cast<io_operation *>(cqe.user_data);
+            op->result_ = cqe.res;
+            op->completed_ = true;
+            std::atomic_ref(*cq_head_).store(++head, std::memory_order_release);
+            --in_flight_;
+            ++reaped;
+            if (op->waiting_) {
+                op->waiting_.resume();
+                head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed); // It may have reaped as well
+            }
+        }
+        return reaped;
+    }
+
+    int fd_ = -1;
+    void *sq_ring_ = MAP_FAILED;
+    void *cq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0; // Ours, published to sq_tail_ on submission
+
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+#endif
+};
+
+
+/**
+ * `co_await async_read(fd, buffer, offset)` returns the number of bytes read, 0 at the end of the file, and throws
+ * std::system_error on failure. Like pread, the read may be short.
+ *
+ * The awaiting coroutine is resumed by its ring once the read completes. In an event_pipeline, the operation is
+ * reported as the pollable event of the task instead, and polling it drives the ring.
+ */
+template<bool write>
+class io_awaiter : io_operation {
+public:
+    using buffer_t = std::span<conditional_type_t<const std::byte, std::byte, write>>;
+
+    io_awaiter(io_ring &ring, int fd, buffer_t buffer, uint64_t offset) noexcept: ring_(ring), fd_(fd), buffer_(buffer), offset_(offset) {}
+
+    inline bool await_ready() {
+        if (ring_.backend() == io_backend::blocking) {
+            start();
+            return true;
+        }
+        return false;
+    }
+
+    inline void await_suspend(std::coroutine_handle<> awaiting) {
+        if (auto *wait = pending_wait::current) {
+            wait->event = this;
+            wait->is_complete = [](const void *op) -> bool { return static_cast<const io_awaiter *>(op)->is_complete(); };
+        } else {
+            waiting_ = awaiting;
+        }
+        start();
+    }
+
+    inline size_t await_resume() const {
+        if (result_ < 0) {
+            throw std::system_error(-result_, std::system_category(), write ? "async_write" : "async_read");
+        }
+        return static_cast<size_t>(result_);
+    }
+
+    /* Polled by a pipeline: drives the ring */
+    [[nodiscard]] inline bool is_complete() const {
+        if (!completed_) {
+            ring_.poll();
+        }
+        return completed_;
+    }
+
+private:
+    inline void start() {
+        ring_.queue(*this, write, fd_, const_cast<std::byte *>(buffer_.data()), buffer_.size(), offset_);
+    }
+
+    io_ring &ring_;
+    int fd_;
+    buffer_t buffer_;
+    uint64_t offset_;
+};
+
+inline io_awaiter<false> async_read(io_ring &ring, int fd, std::span<std::byte> buffer, uint64_t offset) noexcept {
+    return {ring, fd, buffer, offset};
+}
+
+inline io_awaiter<false> async_read(int fd, std::span<std::byte> buffer, uint64_t offset) {
+    return {io_ring::local(), fd, buffer, offset};
+}
+
+/* `co_await async_write(fd, buffer, offset)` returns the number of bytes written, see async_read */
+inline io_awaiter<true> async_write(io_ring &ring, int fd, std::span<const std::byte> buffer, uint64_t offset) noexcept {
+    return {ring, fd, buffer, offset};
+}
+
+inline io_awaiter<true> async_write(int fd, std::span<const std::byte> buffer, uint64_t offset) {
+    return {io_ring::local(), fd, buffer, offset};
+}
+
+
+static constexpr void static_tests_io() {
+    static_assert(pollable<io_awaiter<false>>);
+    static_assert(std::is_same_v<decltype(std::declval<io_awaiter<false>>().await_resume()), size_t>);
+}
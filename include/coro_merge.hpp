@@ -0,0 +1,361 @@
+#pragma once
+
+#include <coro_generator.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace merge_detail {
+
+    /**
+     * Tournament tree over the current value of each source. Leaf i, the source i, sits at position k + i, and each
+     * inner node keeps the loser of the match played there, the overall winner being kept at position 0. Once the
+     * winner has been consumed and its source advanced, only the matches on its path to the root are replayed:
+     * log2(k) comparisons per value, against a binary heap's two per level.
+     * An exhausted source loses every match.
+     */
+    template<typename T, typename Compare>
+    class loser_tree {
+    public:
+        loser_tree(std::vector<std::optional<T>> &heads, Compare &cmp) : heads_(heads), cmp_(cmp), losers_(std::max<size_t>(heads.size(), 1)) {
+            const size_t k = heads.size();
+            std::vector<size_t> winners(2 * k);
+            for (size_t i = 0; i < k; ++i) {
+                winners[k + i] = i;
+            }
+            for (size_t node = k - 1; node >= 1; --node) {
+                size_t a = winners[2 * node], b = winners[2 * node + 1];
+                bool a_wins = beats(a, b);
+                winners[node] = a_wins ? a : b;
+                losers_[node] = a_wins ? b : a;
+            }
+            losers_[0] = k > 1 ? winners[1] : 0;
+        }
+
+        [[nodiscard]] inline size_t winner() const noexcept { return losers_[0]; }
+
+        /* The value of the winner changed, replays its path to the root */
+        inline void replay() {
+            size_t candidate = losers_[0];
+            for (size_t node = (heads_.size() + candidate) / 2; node >= 1; node /= 2) {
+                if (beats(losers_[node], candidate)) {
+                    std::swap(losers_[node], candidate);
+                }
+            }
+            losers_[0] = candidate;
+        }
+
+    private:
+        inline bool beats(size_t a, size_t b) {
+            if (!heads_[a]) return false;
+            if (!heads_[b]) return true;
+            return std::invoke(cmp_, *heads_[a], *heads_[b]);
+        }
+
+        std::vector<std::optional<T>> &heads_;
+        Compare &cmp_;
+        std::vector<size_t> losers_;
+    };
+
+    /* Moves the current value out of generators, copies it from other ranges */
+    template<typename range_t, typename iterator_t>
+    inline auto current(range_t &range, iterator_t &it) {
+        if constexpr (requires { range.take(); }) {
+            return std::move(*range.take());
+        } else {
+            return std::ranges::range_value_t<range_t>(*it);
+        }
+    }
+
+    template<typename range_t, typename Compare>
+    generator<std::ranges::range_value_t<range_t>> merge(std::span<range_t> sources, Compare cmp) {
+        using T = std::ranges::range_value_t<range_t>;
+        using iterator_t = std::ranges::iterator_t<range_t>;
+        const size_t k = sources.size();
+        if (k == 0) {
+            co_return;
+        }
+        std::vector<std::optional<iterator_t>> iterators(k);
+        std::vector<std::optional<T>> heads(k);
+        for (size_t i = 0; i < k; ++i) {
+            iterators[i].emplace(std::ranges::begin(sources[i]));
+            if (*iterators[i] != std::ranges::end(sources[i])) {
+                heads[i].emplace(current(sources[i], *iterators[i]));
+            }
+        }
+        auto tree = loser_tree<T, Compare>(heads, cmp);
+        while (true) {
+            size_t w = tree.winner();
+            if (!heads[w]) {
+                co_return; // The winner is exhausted: they all are
+            }
+            co_yield std::move(*heads[w]);
+            if (++*iterators[w] != std::ranges::end(sources[w])) {
+                heads[w].emplace(current(sources[w], *iterators[w]));
+            } else {
+                heads[w].reset();
+            }
+            tree.replay();
+        }
+    }
+
+    template<typename range_t, typename Compare>
+    generator<std::ranges::range_value_t<range_t>> merge_owned(std::vector<range_t> sources, Compare cmp) {
+        for (auto &&value: merge(std::span(sources), std::move(cmp))) {
+            co_yield std::move(value);
+        }
+    }
+}
+
+
+/**
+ * Merges sorted sources, typically generators, into one sorted generator. Each value costs log2(k) comparisons for
+ * k sources, through a loser tree. Values are moved out of generators, copied from other ranges. Equal values of
+ * different sources come out in no particular order.
+ *
+ * The sources are read in place: they must outlive the merged generator. The overload taking a vector owns them.
+ */
+template<std::ranges::input_range range_t, typename Compare = std::less<>>
+generator<std::ranges::range_value_t<range_t>> merge(std::span<range_t> sources, Compare cmp = {}) {
+    return merge_detail::merge(sources, std::move(cmp));
+}
+
+template<std::ranges::input_range range_t, typename Compare = std::less<>>
+generator<std::ranges::range_value_t<range_t>> merge(std::vector<range_t> sources, Compare cmp = {}) {
+    return merge_detail::merge_owned(std::move(sources), std::move(cmp));
+}
+
+
+namespace merge_detail {
+
+    /* Anonymous temporary file: unlinked as soon as created, it is gone with its descriptor even after a crash */
+    class run_file {
+    public:
+        explicit run_file(const std::filesystem::path &dir) {
+            auto path = (dir / "coro_runXXXXXX").string();
+            fd_ = ::mkostemp(path.data(), O_CLOEXEC);
+            if (fd_ < 0) {
+                throw std::system_error(errno, std::system_category(), "mkostemp " + path);
+            }
+            ::unlink(path.c_str());
+        }
+
+        run_file(const run_file &) = delete;
+
+        run_file &operator=(const run_file &) = delete;
+
+        run_file(run_file &&other) noexcept: fd_(std::exchange(other.fd_, -1)) {}
+
+        run_file &operator=(run_file &&other) noexcept {
+            if (&other != this) {
+                if (fd_ >= 0) ::close(fd_);
+                fd_ = std::exchange(other.fd_, -1);
+            }
+            return *this;
+        }
+
+        ~run_file() {
+            if (fd_ >= 0) ::close(fd_);
+        }
+
+        void write(const void *data, size_t size) {
+            auto *bytes = static_cast<const char *>(data);
+            while (size > 0) {
+                auto written = ::write(fd_, bytes, size);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::system_error(errno, std::system_category(), "writing a sorted run");
+                }
+                bytes += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+
+        /* Fills the buffer from `offset` on, returns the number of bytes read */
+        size_t read(void *data, size_t size, size_t offset) {
+            size_t total = 0;
+            while (total < size) {
+                auto count = ::pread(fd_, static_cast<char *>(data) + total, size - total, static_cast<off_t>(offset + total));
+                if (count < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::system_error(errno, std::system_category(), "reading a sorted run");
+                }
+                if (count == 0) break;
+                total += static_cast<size_t>(count);
+            }
+            return total;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    /* A sorted run in its file */
+    struct sorted_run {
+        run_file file;
+        size_t count;
+    };
+
+    /* Runs merged at once, a file descriptor each: more are first merged into longer runs */
+    static constexpr size_t max_fan_in = 128;
+
+    /* Streams a run back, `buffer_count` values at a time */
+    template<typename T>
+    generator<T> read_run(sorted_run run, size_t buffer_count) {
+        std::vector<T> buffer(std::min(buffer_count, run.count));
+        for (size_t done = 0; done < run.count;) {
+            size_t batch = std::min(buffer.size(), run.count - done);
+            if (run.file.read(buffer.data(), batch * sizeof(T), done * sizeof(T)) != batch * sizeof(T)) {
+                throw std::runtime_error("Sorted run truncated.");
+            }
+            for (size_t i = 0; i < batch; ++i) {
+                co_yield buffer[i];
+            }
+            done += batch;
+        }
+    }
+
+    /* The runs share `budget_count` values of read buffers, a page at least each */
+    template<typename T, typename Compare>
+    generator<T> merge_runs(std::vector<sorted_run> runs, size_t budget_count, Compare cmp) {
+        std::vector<generator<T>> sources;
+        sources.reserve(runs.size());
+        size_t buffer_count = std::max(budget_count / std::max<size_t>(runs.size(), 1), 4096 / sizeof(T) + 1);
+        for (auto &run: runs) {
+            sources.push_back(read_run<T>(std::move(run), buffer_count));
+        }
+        return ::merge(std::move(sources), std::move(cmp));
+    }
+
+    /**
+     * The runs of an external sort, by level: a level full of runs is merged into a single run of the next level.
+     * Each value is then written once per level, and there are log(n) / log(max_fan_in) levels.
+     */
+    template<typename T, typename Compare>
+    class run_levels {
+    public:
+        run_levels(std::filesystem::path dir, Compare &cmp) : dir_(std::move(dir)), cmp_(cmp) {}
+
+        [[nodiscard]] inline bool empty() const noexcept { return levels_.empty(); }
+
+        /**
+         * Writes a sorted chunk as a run. Once `max_fan_in` runs are open, the lowest levels are merged, whole, until
+         * at least half of the runs are taken, into a run of the level above. The chunk is then the write buffer of
+         * the merge, half for writes and half for reads.
+         */
+        void spill(std::vector<T> &chunk) {
+            auto run = sorted_run{run_file(dir_), chunk.size()};
+            run.file.write(chunk.data(), chunk.size() * sizeof(T));
+            if (levels_.empty()) {
+                levels_.emplace_back();
+            }
+            levels_[0].push_back(std::move(run));
+            if (++open_runs_ < max_fan_in) {
+                return;
+            }
+            std::vector<sorted_run> merged;
+            size_t level = 0;
+            for (; merged.size() < max_fan_in / 2; ++level) {
+                std::move(levels_[level].begin(), levels_[level].end(), std::back_inserter(merged));
+                levels_[level].clear();
+            }
+            if (level == levels_.size()) {
+                levels_.emplace_back();
+            }
+            open_runs_ -= merged.size() - 1;
+
+            size_t half = std::max<size_t>(chunk.capacity() / 2, 1);
+            run = sorted_run{run_file(dir_), 0};
+            chunk.clear();
+            for (auto value: merge_runs<T>(std::move(merged), half, cmp_)) {
+                chunk.push_back(value);
+                if (chunk.size() == half) {
+                    run.file.write(chunk.data(), chunk.size() * sizeof(T));
+                    run.count += chunk.size();
+                    chunk.clear();
+                }
+            }
+            run.file.write(chunk.data(), chunk.size() * sizeof(T));
+            run.count += chunk.size();
+            levels_[level].push_back(std::move(run));
+        }
+
+        /* Merges all the runs left */
+        generator<T> merge(size_t budget_count) {
+            std::vector<sorted_run> runs;
+            for (auto &level: levels_) {
+                std::move(level.begin(), level.end(), std::back_inserter(runs));
+            }
+            levels_.clear();
+            open_runs_ = 0;
+            return merge_runs<T>(std::move(runs), budget_count, cmp_);
+        }
+
+    private:
+        std::filesystem::path dir_;
+        Compare &cmp_;
+        std::vector<std::vector<sorted_run>> levels_; // Runs of similar lengths, the shortest first
+        size_t open_runs_ = 0;
+    };
+}
+
+
+/**
+ * Sorts a stream bigger than memory. The input is read in chunks of `memory_budget` bytes, each chunk is sorted and
+ * written as a run to an anonymous file of `temp_dir`, then the runs are merged back through merge(), each one read
+ * through a buffer taking its share of the budget. Whenever 128 runs are on disk, the shortest ones are first merged
+ * into a longer one, so that 128 run files at most are open at once, plus the one being written. A stream fitting in
+ * a single chunk is sorted in memory only.
+ *
+ * The values are written and read back as raw bytes, so `T` must be trivially copyable. The input is taken by
+ * value: move a generator in. Nothing happens before the first value is asked for.
+ */
+template<std::ranges::input_range range_t, typename Compare = std::less<>>
+requires(std::is_trivially_copyable_v<std::ranges::range_value_t<range_t>>)
+generator<std::ranges::range_value_t<range_t>> external_sort(range_t input, size_t memory_budget, Compare cmp = {},
+                                                             std::filesystem::path temp_dir = std::filesystem::temp_directory_path()) {
+    using T = std::ranges::range_value_t<range_t>;
+    const size_t chunk_count = std::max<size_t>(memory_budget / sizeof(T), 1);
+    auto runs = merge_detail::run_levels<T, Compare>(std::move(temp_dir), cmp);
+    std::vector<T> chunk;
+    chunk.reserve(chunk_count);
+
+    auto it = std::ranges::begin(input);
+    auto end = std::ranges::end(input);
+    while (it != end) {
+        chunk.clear();
+        for (; it != end && chunk.size() < chunk_count; ++it) {
+            chunk.push_back(*it);
+        }
+        std::sort(chunk.begin(), chunk.end(), cmp);
+        if (runs.empty() && it == end) {
+            for (auto &value: chunk) {
+                co_yield value; // Fits in memory
+            }
+            co_return;
+        }
+        runs.spill(chunk);
+    }
+    chunk = std::vector<T>(); // Gives the budget to the read buffers
+
+    for (auto value: runs.merge(chunk_count)) {
+        co_yield value;
+    }
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <coro_generator.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Read-only private mapping of a whole file, advised for sequential access: the kernel reads ahead aggressively and
+ * drops the pages behind. An empty file maps to an empty view.
+ */
+class mapped_file {
+public:
+    explicit mapped_file(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::system_category(), "open " + path);
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) < 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::system_category(), "fstat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::system_category(), "mmap " + path);
+            }
+            data_ = static_cast<const char *>(data);
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd); // The mapping keeps the file alive
+    }
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file &&other) noexcept: data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    ~mapped_file() {
+        if (data_) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    [[nodiscard]] inline std::string_view view() const noexcept { return {data_, size_}; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+
+namespace mmap_detail {
+
+    static constexpr size_t block_size = 64;
+
+    /* Bit i is set when block[i] is the delimiter */
+    inline uint64_t delimiter_mask(const char *block, char delimiter) noexcept {
+#if defined(__AVX2__)
+        auto needle = _mm256_set1_epi8(delimiter);
+        auto lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block)), needle)));
+        auto hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32)), needle)));
+        return lo | (static_cast<uint64_t>(hi) << 32);
+#elif defined(__SSE2__)
+        auto needle = _mm_set1_epi8(delimiter);
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block_size; i += 16) {
+            auto bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i)), needle)));
+            mask |= static_cast<uint64_t>(bits) << i;
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block_size; ++i) {
+            mask |= static_cast<uint64_t>(block[i] == delimiter) << i;
+        }
+        return mask;
+#endif
+    }
+
+    /**
+     * Finds the delimiters of a buffer in order. Each block of 64 bytes is compared at once into a bit mask, then
+     * each delimiter costs a count of trailing zeros: short lines do not pay for a full vector scan each.
+     * The last partial block is copied and padded, so nothing is read past the end of the buffer.
+     */
+    class delimiter_scanner {
+    public:
+        delimiter_scanner(std::string_view text, char delimiter) noexcept
+                : block_(text.data()), end_(text.data() + text.size()), delimiter_(delimiter) {
+            mask_ = text.empty() ? 0 : load(block_);
+        }
+
+        /* The next delimiter, or the end of the buffer */
+        inline const char *next() noexcept {
+            while (mask_ == 0) {
+                block_ += block_size;
+                if (block_ >= end_) {
+                    block_ = end_;
+                    return end_;
+                }
+                mask_ = load(block_);
+            }
+            const char *found = block_ + std::countr_zero(mask_);
+            mask_ &= mask_ - 1;
+            return found;
+        }
+
+    private:
+        inline uint64_t load(const char *block) const noexcept {
+            auto remaining = static_cast<size_t>(end_ - block);
+            if (remaining >= block_size) [[likely]] {
+                return delimiter_mask(block, delimiter_);
+            }
+            char padded[block_size];
+            std::memcpy(padded, block, remaining);
+            std::memset(padded + remaining, delimiter_ ^ 1, block_size - remaining);
+            return delimiter_mask(padded, delimiter_);
+        }
+
+        const char *block_;
+        const char *end_;
+        uint64_t mask_;
+        char delimiter_;
+    };
+
+    /* The mapping is a parameter: it lives as long as the frame, past the end of the body */
+    inline generator<std::string_view> lines(mapped_file file, char delimiter) {
+        auto text = file.view();
+        auto scanner = delimiter_scanner(text, delimiter);
+        const char *begin = text.data();
+        const char *end = text.data() + text.size();
+        while (begin != end) {
+            const char *found = scanner.next();
+            co_yield std::string_view(begin, static_cast<size_t>(found - begin));
+            begin = found == end ? end : found + 1;
+        }
+    }
+
+    inline generator<std::span<const std::byte>> records(mapped_file file, size_t record_size) {
+        auto bytes = std::as_bytes(std::span(file.view()));
+        for (size_t offset = 0; offset < bytes.size(); offset += record_size) {
+            co_yield bytes.subspan(offset, std::min(record_size, bytes.size() - offset));
+        }
+    }
+}
+
+
+/**
+ * The lines of a file, as views into a memory mapping of it: nothing is copied. The views stay valid as long as the
+ * generator is alive, not only until the next line.
+ * Like std::getline, the delimiter is not part of the line, a '\r' before it is, and a last line without delimiter
+ * is yielded unless empty. The file is mapped right away, std::system_error is thrown if it cannot be.
+ */
+inline generator<std::string_view> mmap_lines(const std::string &path, char delimiter = '\n') {
+    return mmap_detail::lines(mapped_file(path), delimiter);
+}
+
+/**
+ * The fixed-size records of a binary file, as views into a memory mapping of it, see mmap_lines(). If the size of
+ * the file is not a multiple of `record_size`, the last record is shorter. Throws std::invalid_argument on a zero size.
+ */
+inline generator<std::span<const std::byte>> mmap_records(const std::string &path, size_t record_size) {
+    if (record_size == 0) {
+        throw std::invalid_argument("Record size set to 0 in mmap_records.");
+    }
+    return mmap_detail::records(mapped_file(path), record_size);
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+#include <coro_sync_wait.hpp>
+#include <coro_thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace parallel_detail {
+
+    /* A generator handing its values over: they are moved out of the frame instead of copied */
+    template<typename range_t>
+    concept takes_values = requires(range_t &range) {
+        range.resume();
+        range.take();
+        { range.done() } -> std::convertible_to<bool>;
+    };
+
+    /**
+     * An input range drained by several threads: each consumer pulls a chunk of values under the lock, then
+     * processes it on its own. Each consumer sizes its chunks so that processing one takes about `target_chunk_time`:
+     * a cheap consumer takes big chunks and rarely contends on the lock, an expensive one takes small chunks and
+     * the last chunks stay balanced across the threads.
+     *
+     * The first exception thrown by the range or by a consumer stops everyone and is kept to be rethrown.
+     */
+    template<typename range_t>
+    class chunked_source {
+    public:
+        using value_type = std::ranges::range_value_t<range_t>;
+
+        static constexpr auto target_chunk_time = std::chrono::microseconds(50);
+        static constexpr size_t max_chunk = 4096;
+
+        explicit chunked_source(range_t &range) : range_(range) {}
+
+        /* Runs `consume(values)` on chunks until the range is exhausted, from any number of threads */
+        template<typename Consumer>
+        void drain(Consumer &&consume) noexcept {
+            std::vector<value_type> buffer;
+            size_t chunk = 1;
+            try {
+                while (pull(buffer, chunk)) {
+                    auto start = std::chrono::steady_clock::now();
+                    consume(std::span<value_type>(buffer));
+                    auto elapsed = std::chrono::steady_clock::now() - start;
+                    if (elapsed < target_chunk_time / 2) {
+                        chunk = std::min(2 * chunk, max_chunk);
+                    } else if (elapsed > 2 * target_chunk_time) {
+                        chunk = std::max<size_t>(chunk / 2, 1);
+                    }
+                }
+            } catch (...) {
+                std::lock_guard lock(mutex_);
+                fail();
+            }
+        }
+
+        void rethrow_if_failed() const {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+
+    private:
+        /* A failure of the range ends it, the values produced before are still handed out */
+        bool pull(std::vector<value_type> &buffer, size_t count) {
+            buffer.clear();
+            std::lock_guard lock(mutex_);
+            try {
+                if constexpr (takes_values<range_t>) {
+                    while (!done_ && buffer.size() < count) {
+                        range_.resume();
+                        if (range_.done()) {
+                            done_ = true;
+                        } else {
+                            buffer.push_back(std::move(*range_.take()));
+                        }
+                    }
+                } else {
+                    if (!it_ && !done_) {
+                        it_.emplace(std::ranges::begin(range_));
+                    }
+                    while (!done_ && buffer.size() < count) {
+                        if (*it_ == std::ranges::end(range_)) {
+                            done_ = true;
+                        } else {
+                            buffer.push_back(**it_);
+                            ++*it_;
+                        }
+                    }
+                }
+            } catch (...) {
+                fail();
+            }
+            return !buffer.empty();
+        }
+
+        /* Under the lock */
+        inline void fail() noexcept {
+            if (!error_) error_ = std::current_exception();
+            done_ = true;
+        }
+
+        range_t &range_;
+        std::mutex mutex_;
+        std::optional<std::ranges::iterator_t<range_t>> it_;
+        bool done_ = false;
+        std::exception_ptr error_;
+    };
+
+    template<typename Drain>
+    single_task<void> drain_on(thread_pool &pool, Drain &drain) {
+        co_await pool.schedule();
+        drain();
+    }
+
+    /* The calling thread drains along with one task per worker, then waits for them */
+    template<typename Drain>
+    single_task<void, false> drain_everywhere(thread_pool &pool, Drain &drain) {
+        std::vector<single_task<void>> helpers;
+        helpers.reserve(pool.size());
+        for (size_t i = 0; i < pool.size(); ++i) {
+            helpers.push_back(drain_on(pool, drain));
+        }
+        drain();
+        for (auto &helper: helpers) {
+            co_await helper;
+        }
+    }
+
+    template<typename Drain>
+    void run(thread_pool &pool, Drain &&drain) {
+        if (pool.on_worker()) {
+            throw std::logic_error("parallel algorithms block their caller, call them from outside the pool");
+        }
+        sync_wait(drain_everywhere(pool, drain));
+    }
+
+    /* One per thread, on its own cache line */
+    template<typename T>
+    struct alignas(64) partial {
+        std::optional<T> value;
+    };
+}
+
+
+/**
+ * Calls `fn(value)` on every value of `range`, typically a generator, from the workers of `pool` and the calling
+ * thread. The range is consumed by one thread at a time, in chunks, so that a cheap producer feeds expensive
+ * consumers on all the cores. `fn` is called concurrently and in no particular order.
+ * Values of generators are moved out of their frame, those of other ranges are copied.
+ *
+ * Blocks until the range is exhausted. The first exception thrown by the range or by `fn` is rethrown, once the
+ * other threads have finished their current chunk.
+ */
+template<std::ranges::input_range range_t, typename Fn>
+void parallel_for_each(range_t &&range, thread_pool &pool, Fn &&fn) {
+    using source_t = parallel_detail::chunked_source<std::remove_reference_t<range_t>>;
+    auto source = source_t(range);
+    parallel_detail::run(pool, [&]() {
+        source.drain([&](std::span<typename source_t::value_type> values) {
+            for (auto &value: values) {
+                std::invoke(fn, value);
+            }
+        });
+    });
+    source.rethrow_if_failed();
+}
+
+/**
+ * Folds the values of `range` with `op`, from the workers of `pool` and the calling thread: each thread folds the
+ * chunks it pulls into its own partial result, then the partial results are folded into `init`.
+ * The values are folded in no particular order and grouping: `op` must be associative and commutative.
+ */
+template<std::ranges::input_range range_t, typename T, typename Op>
+requires(std::constructible_from<T, std::ranges::range_value_t<range_t>>)
+T parallel_reduce(range_t &&range, thread_pool &pool, T init, Op op) {
+    using source_t = parallel_detail::chunked_source<std::remove_reference_t<range_t>>;
+    auto source = source_t(range);
+    std::vector<parallel_detail::partial<T>> partials(pool.size() + 1);
+    std::atomic<size_t> next_partial{0};
+    parallel_detail::run(pool, [&]() {
+        auto &partial = partials[next_partial.fetch_add(1, std::memory_order_relaxed)].value;
+        source.drain([&](std::span<typename source_t::value_type> values) {
+            for (auto &value: values) {
+                if (partial) {
+                    *partial = std::invoke(op, std::move(*partial), std::move(value));
+                } else {
+                    partial.emplace(std::move(value));
+                }
+            }
+        });
+    });
+    source.rethrow_if_failed();
+    for (auto &partial: partials) {
+        if (partial.value) {
+            init = std::invoke(op, std::move(init), std::move(*partial.value));
+        }
+    }
+    return init;
+}
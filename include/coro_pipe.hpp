@@ -0,0 +1,338 @@
+#pragma once
+
+#include <coro_generator.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pipe_detail {
+
+    /**
+     * One side of a ring waiting for the other: it spins for a while, then sleeps on an epoch that the other side
+     * bumps when it sees it asleep. The sleeper announces itself and looks again, the waker publishes and looks for
+     * a sleeper, both behind a fence, so that one of them always sees the other.
+     */
+    class sleeper {
+    public:
+        static constexpr int spin_count = 128;
+
+        template<typename Ready>
+        inline void wait_until(Ready &&ready) {
+            for (int i = 0; i < spin_count; ++i) {
+                if (ready()) return;
+            }
+            while (true) {
+                auto epoch = epoch_.load(std::memory_order_seq_cst);
+                sleeping_.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (ready()) {
+                    sleeping_.store(false, std::memory_order_relaxed);
+                    return;
+                }
+                epoch_.wait(epoch, std::memory_order_seq_cst);
+                if (ready()) return;
+            }
+        }
+
+        /* The first waker clears the flag, the others do not pay for a notify until the sleeper sleeps again */
+        inline void wake() noexcept {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping_.load(std::memory_order_seq_cst) && sleeping_.exchange(false, std::memory_order_seq_cst)) {
+                epoch_.fetch_add(1, std::memory_order_seq_cst);
+                epoch_.notify_one();
+            }
+        }
+
+    private:
+        std::atomic<uint32_t> epoch_{0};
+        std::atomic<bool> sleeping_{false};
+    };
+
+    /* The part of a ring that does not depend on the values: positions, and the ends of the stream on both sides */
+    class ring_state {
+    public:
+        /* Consumer side: the producer stops at its next full ring */
+        inline void abandon() noexcept {
+            abandoned_.store(true, std::memory_order_seq_cst);
+            producer_.wake();
+        }
+
+        [[nodiscard]] inline bool abandoned() const noexcept { return abandoned_.load(std::memory_order_acquire); }
+
+    protected:
+        explicit ring_state(size_t capacity) : mask_(capacity - 1) {}
+
+        const size_t mask_;
+
+        alignas(64) std::atomic<uint64_t> head_{0}; // Next value to read
+        uint64_t cached_tail_ = 0; // Consumer only
+        sleeper consumer_;
+
+        alignas(64) std::atomic<uint64_t> tail_{0}; // Next slot to write
+        uint64_t cached_head_ = 0; // Producer only
+        sleeper producer_;
+
+        alignas(64) std::atomic<bool> closed_{false};
+        std::atomic<bool> abandoned_{false};
+        std::exception_ptr error_; // Written before closing
+    };
+
+    /**
+     * Bounded single-producer single-consumer ring between two stage threads. The values are constructed in place in
+     * the slots and read there. Each side keeps a cached copy of the other side's position and only reloads it when
+     * the ring looks full or empty, so the shared cache lines bounce once per lap instead of once per value.
+     *
+     * A full ring blocks the producer: this is the backpressure that bounds how far a stage runs ahead.
+     */
+    template<typename T>
+    class spsc_ring : public ring_state {
+    public:
+        explicit spsc_ring(size_t capacity) : ring_state(std::bit_ceil(std::max<size_t>(capacity, 2))), slots_(std::make_unique<slot[]>(mask_ + 1)) {}
+
+        spsc_ring(const spsc_ring &) = delete;
+
+        spsc_ring &operator=(const spsc_ring &) = delete;
+
+        ~spsc_ring() {
+            for (auto i = head_.load(std::memory_order_relaxed), end = tail_.load(std::memory_order_relaxed); i != end; ++i) {
+                std::destroy_at(at(i));
+            }
+        }
+
+        /* Producer: false once the consumer abandoned the ring, the value is then dropped */
+        template<typename U>
+        bool push(U &&value) {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ > mask_) {
+                producer_.wait_until([&]() {
+                    cached_head_ = head_.load(std::memory_order_acquire);
+                    return tail - cached_head_ <= mask_ || abandoned();
+                });
+                if (abandoned()) return false;
+            }
+            std::construct_at(at(tail), std::forward<U>(value));
+            tail_.store(tail + 1, std::memory_order_release);
+            consumer_.wake();
+            return true;
+        }
+
+        /* Producer: no more values, after `error` if set */
+        void close(std::exception_ptr error = nullptr) noexcept {
+            error_ = std::move(error);
+            closed_.store(true, std::memory_order_seq_cst);
+            consumer_.wake();
+        }
+
+        /* Consumer: waits for the next value, nullptr once the ring is closed and empty */
+        T *front() {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_) {
+                consumer_.wait_until([&]() {
+                    cached_tail_ = tail_.load(std::memory_order_acquire);
+                    return head != cached_tail_ || closed_.load(std::memory_order_acquire);
+                });
+                cached_tail_ = tail_.load(std::memory_order_acquire); // Values pushed right before closing
+                if (head == cached_tail_) return nullptr;
+            }
+            return at(head);
+        }
+
+        /* Consumer: releases the value returned by front() */
+        inline void pop() noexcept {
+            auto head = head_.load(std::memory_order_relaxed);
+            std::destroy_at(at(head));
+            head_.store(head + 1, std::memory_order_release);
+            producer_.wake();
+        }
+
+        /* Consumer, once front() returned nullptr */
+        [[nodiscard]] inline const std::exception_ptr &error() const noexcept { return error_; }
+
+    private:
+        struct slot {
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        inline T *at(uint64_t index) noexcept { return std::launder(reinterpret_cast<T *>(slots_[index & mask_].storage)); }
+
+        std::unique_ptr<slot[]> slots_;
+    };
+
+    /**
+     * The threads of a pipeline and the rings between them. Destroying it abandons every ring, so that each stage
+     * stops at its next push and abandons its own input in turn, then joins the threads.
+     */
+    class stage_threads {
+    public:
+        stage_threads() = default;
+
+        stage_threads(const stage_threads &) = delete;
+
+        stage_threads &operator=(const stage_threads &) = delete;
+
+        ~stage_threads() {
+            for (auto &ring: rings_) {
+                ring->abandon();
+            }
+            for (auto &thread: threads_) {
+                thread.join();
+            }
+        }
+
+        template<typename T>
+        spsc_ring<T> &make_ring(size_t capacity) {
+            auto ring = std::make_shared<spsc_ring<T>>(capacity);
+            rings_.push_back(ring);
+            return *ring;
+        }
+
+        /**
+         * Runs `produce(output)` on a new thread. Whatever ends it, the input ring is abandoned and the output ring
+         * closed, with the exception thrown if any.
+         */
+        template<typename T, typename Produce>
+        void spawn(ring_state *input, spsc_ring<T> &output, Produce &&produce) {
+            threads_.emplace_back([this, input, &output, produce = std::forward<Produce>(produce)]() mutable {
+                std::exception_ptr error;
+                try {
+                    produce(output);
+                } catch (...) {
+                    error = std::current_exception();
+                    fail(error);
+                }
+                if (input) input->abandon();
+                output.close(std::move(error));
+            });
+        }
+
+        /* The first exception thrown by any stage, even one that a stage without exceptions propagation swallowed */
+        void rethrow_if_failed() {
+            std::lock_guard lock(mutex_);
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+
+    private:
+        void fail(const std::exception_ptr &error) {
+            std::lock_guard lock(mutex_);
+            if (!error_) error_ = error;
+        }
+
+        std::vector<std::shared_ptr<ring_state>> rings_;
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::exception_ptr error_;
+    };
+
+    /* Pushes the values of `range` until it ends or the consumer goes away. Generator values are moved out */
+    template<typename range_t, typename T>
+    void feed(range_t &range, spsc_ring<T> &output) {
+        if constexpr (requires { range.take(); }) {
+            for (auto it = range.begin(); it != range.end(); ++it) {
+                if (!output.push(std::move(*range.take()))) return;
+            }
+        } else {
+            for (auto &&value: range) {
+                if (!output.push(std::forward<decltype(value)>(value))) return;
+            }
+        }
+    }
+
+    /* The input of a stage: the failure of the previous stage is rethrown into the stage if it propagates exceptions */
+    template<typename T, bool enable_exceptions_propagation>
+    generator<T, enable_exceptions_propagation> read(spsc_ring<T> &input) {
+        while (T *value = input.front()) {
+            co_yield std::move(*value);
+            input.pop();
+        }
+        if constexpr (enable_exceptions_propagation) {
+            if (input.error()) {
+                std::rethrow_exception(input.error());
+            }
+        }
+    }
+
+    /* A stage takes a generator<T>, or a generator<T, false> */
+    template<typename stage_t, typename T>
+    constexpr bool propagates_to = std::invocable<stage_t &, generator<T, true>>;
+
+    template<typename stage_t, typename T>
+    using stage_input_t = generator<T, propagates_to<stage_t, T>>;
+
+    template<typename stage_t, typename T>
+    using stage_output_t = std::ranges::range_value_t<std::invoke_result_t<stage_t &, stage_input_t<stage_t, T>>>;
+
+    template<size_t depth, typename range_t>
+    auto &launch_source(stage_threads &threads, range_t &&source) {
+        using T = std::ranges::range_value_t<range_t>;
+        auto &output = threads.make_ring<T>(depth);
+        threads.spawn(nullptr, output, [source = std::forward<range_t>(source)](spsc_ring<T> &output) mutable {
+            auto range = std::move(source); // Destroyed on the stage thread
+            feed(range, output);
+        });
+        return output;
+    }
+
+    template<size_t depth, typename T>
+    auto &launch_stages(stage_threads &, spsc_ring<T> &last) {
+        return last;
+    }
+
+    template<size_t depth, typename T, typename stage_t, typename... stages_t>
+    auto &launch_stages(stage_threads &threads, spsc_ring<T> &input, stage_t &&stage, stages_t &&...stages) {
+        using U = stage_output_t<std::decay_t<stage_t>, T>;
+        auto &output = threads.make_ring<U>(depth);
+        threads.spawn(&input, output, [&input, stage = std::forward<stage_t>(stage)](spsc_ring<U> &output) mutable {
+            auto range = std::invoke(stage, read<T, propagates_to<std::decay_t<stage_t>, T>>(input));
+            feed(range, output);
+        });
+        return launch_stages<depth>(threads, output, std::forward<stages_t>(stages)...);
+    }
+
+    /* Owns the threads: destroying the returned generator stops and joins them */
+    template<typename T>
+    generator<T> drain(std::unique_ptr<stage_threads> threads, spsc_ring<T> &last) {
+        while (T *value = last.front()) {
+            co_yield std::move(*value);
+            last.pop();
+        }
+        threads->rethrow_if_failed();
+    }
+}
+
+
+/**
+ * Runs `source`, typically a generator, and each of the `stages` on its own thread, connected by bounded rings of
+ * `depth` values: `pipe(parse(file), transform, aggregate)`. A stage is called with a generator over the values of
+ * the previous stage, `generator<T>` or `generator<T, false>`, and returns the range of its own values, so the
+ * generators that chain by taking their source as a parameter run as they are: `[](generator<T> in) { return
+ * transform(std::move(in)); }`. The values are moved from stage to stage.
+ *
+ * Each stage runs ahead of the next by up to `depth` values, then waits. The stages are started right away and
+ * the values of the last one are read from the returned generator, on the calling thread.
+ *
+ * The exception ending a stage reaches the next stage through its input generator when it propagates exceptions,
+ * and ends it in turn. Once the last stage ends, the first exception thrown by any stage is rethrown by the
+ * returned generator. Destroying the returned generator early stops the stages at their next value and joins them.
+ */
+template<size_t depth = 1024, std::ranges::input_range range_t, typename... stages_t>
+auto pipe(range_t &&source, stages_t &&...stages) {
+    static_assert(std::is_rvalue_reference_v<range_t &&>, "The source is moved to its own thread");
+    auto threads = std::make_unique<pipe_detail::stage_threads>();
+    auto &last = pipe_detail::launch_stages<depth>(*threads, pipe_detail::launch_source<depth>(*threads, std::forward<range_t>(source)), std::forward<stages_t>(stages)...);
+    return pipe_detail::drain(std::move(threads), last);
+}
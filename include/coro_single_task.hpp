@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <coroutine>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <stdexcept>
@@ -8,18 +11,216 @@
 using namespace std::string_literals;
 
 #include <helpers.hpp>
+#include <coro_frame_pool.hpp>
+#include <coro_trace.hpp>
 
-template<typename T, bool start_immediately, bool enable_exceptions_propagation>
+template<typename T, bool start_immediately, bool enable_exceptions_propagation, typename frame_policy, typename instrumentation>
 struct single_task_promise_type;
 
-template<typename T = void, bool start_immediately = true, bool enable_exceptions_propagation = false>
+/* Stands for the several leaves of a chain awaiting a group of tasks, see task_link */
+struct chain_fork {
+    void (*resume)(chain_fork &fork) = nullptr;
+};
+
+/**
+ * Awaiting tasks form a chain: each promise knows the task awaiting it (its continuation) and the outermost task
+ * of the chain (its root). When a task completes, its final suspend transfers control to the continuation through
+ * symmetric transfer, so deep chains complete without growing the stack.
+ * A task of the chain can also suspend on its own, as single_task are driven by resume(). The root keeps track of
+ * the innermost task currently running, the leaf, and resuming the root resumes the leaf instead.
+ *
+ * A task that moved itself to an executor is detached: it is resumed by the executor only, possibly on another
+ * thread, and may complete while being awaited. The continuation is then handed over atomically: whoever of the
+ * awaiting coroutine and the completing task comes second resumes the awaiting coroutine.
+ * When the detached task belongs to a chain, the chain is owned by the executor: resuming the root does nothing until
+ * the task completes. If the chain is driven from outside, the task then hands it back, with its continuation as the
+ * leaf, and lets the next resume() carry on: the executor never resumes a coroutine the driver can resume as well.
+ *
+ * Several tasks can be awaited at once as a group, see when_all(): they share a countdown, and only the task that
+ * brings it to zero resumes the awaiting coroutine. In a chain driven from outside, the group becomes the leaf, a
+ * fork of the chain: resuming the root resumes the tasks of the group, each of them leading a chain of its own.
+ */
+struct task_link {
+    std::atomic<void *> continuation_{nullptr}; // Address of the awaiting coroutine, or completed_marker() once a detached task is done
+    std::atomic<size_t> *countdown_ = nullptr; // Shared by the tasks of a group, read only once the continuation is seen
+    task_link *root_ = nullptr; // nullptr when this task is the root
+    std::atomic<void *> leaf_{nullptr}; // Only meaningful in the root, nullptr until something gets awaited, executor_marker() while detached, tagged chain_fork of a group
+    bool detached_ = false;
+    bool driven_by_group_ = false; // Awaited by a group that resumes it, in a chain driven from outside
+
+    /* Moves the chain forward: resumes its leaf, the tasks of the group it awaits, or nothing while an executor owns it */
+    inline void resume_chain(std::coroutine_handle<> self) const {
+        void *leaf = leaf_.load(std::memory_order_acquire);
+        if (leaf == executor_marker()) {
+            return; // The executor resumes the chain
+        }
+        if (reinterpret_cast<std::uintptr_t>(leaf) & fork_tag) {
+            auto &fork = *reinterpret_cast<chain_fork *>(reinterpret_cast<std::uintptr_t>(leaf) & ~fork_tag);
+            fork.resume(fork);
+            return;
+        }
+        (leaf ? std::coroutine_handle<>::from_address(leaf) : self).resume();
+    }
+
+    /* Makes a group the leaf of this root, and returns the leaf to restore once the group is done */
+    inline void *fork_leaf(chain_fork &fork) noexcept {
+        return leaf_.exchange(reinterpret_cast<void *>(reinterpret_cast<std::uintptr_t>(&fork) | fork_tag), std::memory_order_relaxed);
+    }
+
+    inline void restore_leaf(void *leaf) noexcept {
+        leaf_.store(leaf, std::memory_order_relaxed);
+    }
+
+    /* Called by executors before taking over the task. Only the first call writes, later ones may race with awaiters reading it. */
+    inline void detach() noexcept {
+        if (!detached_) {
+            detached_ = true;
+            if (root_) {
+                root_->leaf_.store(executor_marker(), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Whether the chain of this root is resumed from outside, rather than awaited or owned by an executor */
+    [[nodiscard]] inline bool driven_chain() const noexcept {
+        return !detached_ && (driven_by_group_ || continuation_.load(std::memory_order_relaxed) == nullptr);
+    }
+
+    [[nodiscard]] inline bool completed(std::coroutine_handle<> self) const noexcept {
+        return detached_ ? continuation_.load(std::memory_order_acquire) == completed_marker() : self.done();
+    }
+
+    /* Root of the chain a task awaited by `parent` joins. A detached task starts its own chain, the one above it is owned by the executor */
+    static inline task_link &chain_root(task_link &parent) noexcept {
+        return parent.detached_ || !parent.root_ ? parent : *parent.root_; // A detached parent may be linked concurrently
+    }
+
+    /* Links the task to the coroutine `awaiting` it, and returns what should run next */
+    template<typename awaiting_promise>
+    inline std::coroutine_handle<> await_from(std::coroutine_handle<awaiting_promise> awaiting, std::coroutine_handle<> self) noexcept {
+        if (detached_) {
+            void *previous_leaf = nullptr;
+            if constexpr (std::is_base_of_v<task_link, awaiting_promise>) {
+                root_ = &chain_root(awaiting.promise()); // Published by the exchange below, read by the task only if it sees us
+                previous_leaf = root_->leaf_.exchange(executor_marker(), std::memory_order_relaxed);
+            }
+            void *expected = nullptr;
+            if (continuation_.compare_exchange_strong(expected, awaiting.address(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return std::noop_coroutine(); // The task will resume us
+            }
+            if constexpr (std::is_base_of_v<task_link, awaiting_promise>) {
+                root_->leaf_.store(previous_leaf, std::memory_order_relaxed);
+                root_ = nullptr;
+            }
+            return awaiting; // Completed in the meantime
+        }
+        continuation_.store(awaiting.address(), std::memory_order_relaxed);
+        if constexpr (std::is_base_of_v<task_link, awaiting_promise>) {
+            root_ = &chain_root(awaiting.promise());
+            root_->leaf_.store(self.address(), std::memory_order_relaxed);
+        }
+        return self;
+    }
+
+    /**
+     * Links the task to a group awaited by `awaiting`. Returns false if the task has already completed: it is then
+     * not linked and does not count down. In a `driven` group, the group resumes the task, and counts it down
+     * itself once it completes if it is detached.
+     */
+    inline bool join_group(std::coroutine_handle<> awaiting, std::atomic<size_t> &countdown, bool driven) noexcept {
+        countdown_ = &countdown;
+        driven_by_group_ = driven;
+        if (detached_) {
+            void *expected = nullptr;
+            if (!continuation_.compare_exchange_strong(expected, awaiting.address(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                countdown_ = nullptr;
+                driven_by_group_ = false;
+                return false;
+            }
+            return true;
+        }
+        continuation_.store(awaiting.address(), std::memory_order_relaxed);
+        return true;
+    }
+
+    /* Unlinks a task from its group. Returns false if the task has completed: it has counted down, or is about to */
+    inline bool leave_group(std::coroutine_handle<> awaiting, std::coroutine_handle<> self) noexcept {
+        if (detached_) {
+            void *expected = awaiting.address();
+            if (!continuation_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return false;
+            }
+        } else {
+            if (self.done()) {
+                return false;
+            }
+            continuation_.store(nullptr, std::memory_order_relaxed);
+        }
+        countdown_ = nullptr;
+        driven_by_group_ = false;
+        return true;
+    }
+
+    struct final_awaiter {
+        static constexpr bool await_ready() noexcept { return false; }
+
+        template<typename promise_t>
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_t> self) const noexcept {
+            task_link &link = self.promise();
+            void *next;
+            if (link.detached_) {
+                next = link.continuation_.exchange(completed_marker(), std::memory_order_acq_rel);
+                if (next && link.driven_by_group_) {
+                    return std::noop_coroutine(); // The group sees it completed and counts it down from the driver
+                }
+                if (next && link.root_ && link.root_->driven_chain()) {
+                    link.root_->leaf_.store(next, std::memory_order_release); // Hands the chain back, the driver resumes it
+                    return std::noop_coroutine();
+                }
+            } else {
+                next = link.continuation_.load(std::memory_order_relaxed);
+                if (link.root_) {
+                    link.root_->leaf_.store(next, std::memory_order_relaxed);
+                }
+            }
+            if (next && link.countdown_ && link.countdown_->fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                next = nullptr; // Another task of the group resumes the awaiting coroutine
+            }
+            return next ? std::coroutine_handle<>::from_address(next) : std::noop_coroutine();
+        }
+
+        static constexpr void await_resume() noexcept {}
+    };
+
+private:
+    static constexpr std::uintptr_t fork_tag = 1; // On the leaf: a chain_fork rather than a coroutine
+
+    static inline void *completed_marker() noexcept {
+        static char marker;
+        return &marker;
+    }
+
+    static inline void *executor_marker() noexcept {
+        static char marker;
+        return &marker;
+    }
+};
+
+/**
+ * `frame_policy` selects where the coroutine frames come from: `pooled_frames` recycles them through the
+ * thread-local frame_pool, `heap_frames` uses the global operator new.
+ * `instrumentation` is `untraced`, or `traced` to record the lifetime of the frames in the trace_log.
+ */
+template<typename T = void, bool start_immediately = true, bool enable_exceptions_propagation = false, typename frame_policy = pooled_frames, typename instrumentation = untraced>
 struct single_task {
 
     /**
      * The promise will be stored in the coroutine execution context along the variables,
      * registers, instruction pointer, parameters, all of the function state (lambdas too).
      */
-    using promise_type = single_task_promise_type<T, start_immediately, enable_exceptions_propagation>;
+    using promise_type = single_task_promise_type<T, start_immediately, enable_exceptions_propagation, frame_policy, instrumentation>;
+
+    using value_type = T;
 
 public:
     operator std::coroutine_handle<promise_type>() const noexcept { return handle_; }
@@ -37,6 +238,10 @@ private:
         }
     }
 
+    [[nodiscard]] inline bool has_result() const noexcept requires(!std::is_void_v<T>) {
+        return handle_ && handle_.done() && handle_.promise().has_value();
+    }
+
 public:
     void destroy() noexcept {
         if (handle_) {
@@ -45,14 +250,21 @@ public:
         }
     }
 
-    inline auto get() noexcept(!enable_exceptions_propagation) {
+    /**
+     * Whether the task is done for void tasks. Otherwise, a copy of the result, or std::nullopt while running or
+     * if the task failed without exceptions propagation.
+     * A move-only result is not copied, a pointer to it is returned instead, nullptr when there is none.
+     */
+    inline auto get() &noexcept(!enable_exceptions_propagation) {
         if constexpr(enable_exceptions_propagation) {
             rethrow_exceptions();
         }
         if constexpr (std::is_void_v<T>) {
             return handle_.done();
+        } else if constexpr (!std::is_copy_constructible_v<T>) {
+            return has_result() ? &handle_.promise().get_value() : nullptr;
         } else {
-            if (handle_ && handle_.done()) {
+            if (has_result()) {
                 return std::optional<T>(handle_.promise().get_value());
             } else {
                 return std::optional<T>(std::nullopt);
@@ -60,12 +272,49 @@ public:
         }
     }
 
+    /* On a temporary task, the result is moved out */
+    inline auto get() &&noexcept(!enable_exceptions_propagation) {
+        if constexpr (std::is_void_v<T>) {
+            return get();
+        } else {
+            return take();
+        }
+    }
+
+    /**
+     * Moves the result out, or returns std::nullopt while running or if the task failed. The frame is released right
+     * away: the result can only be taken once, the task is empty afterwards.
+     */
+    inline std::optional<T> take() noexcept(!enable_exceptions_propagation) requires(!std::is_void_v<T>) {
+        if constexpr(enable_exceptions_propagation) {
+            rethrow_exceptions();
+        }
+        if (!has_result()) {
+            return std::nullopt;
+        }
+        auto result = std::optional<T>(handle_.promise().take_value());
+        destroy();
+        return result;
+    }
+
+    /**
+     * The result of a task awaited without one, when it failed without exceptions propagation: default constructed,
+     * as there is nothing to rethrow.
+     */
+    static inline T missing_result() noexcept requires(!std::is_void_v<T>) {
+        if constexpr (std::is_default_constructible_v<T>) {
+            return T{};
+        } else {
+            std::terminate(); // Awaited a failed task whose result cannot be made up
+        }
+    }
+
     inline auto resume() noexcept(!enable_exceptions_propagation) {
         if constexpr(enable_exceptions_propagation) {
             rethrow_exceptions();
         }
         if (handle_ && !handle_.done()) {
-            handle_.resume();
+            handle_.promise().resume_chain(handle_);
         }
         return get();
     }
@@ -74,6 +323,45 @@ public:
         return resume();
     }
 
+    /**
+     * Awaiting a task from another coroutine: the task is resumed right away through symmetric transfer and the
+     * awaiting coroutine is resumed when it completes. The result is returned, or the exception rethrown.
+     * Awaiting a temporary task, or a task with a move-only result, moves the result out of it.
+     */
+    template<bool consume>
+    struct awaiter {
+        single_task &task_;
+
+        [[nodiscard]] inline bool await_ready() const noexcept {
+            return !task_.handle_ || task_.handle_.promise().completed(task_.handle_);
+        }
+
+        template<typename awaiting_promise>
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<awaiting_promise> awaiting) noexcept {
+            return task_.handle_.promise().await_from(awaiting, task_.handle_);
+        }
+
+        inline T await_resume() noexcept(!enable_exceptions_propagation) {
+            if constexpr (std::is_void_v<T>) {
+                task_.get();
+            } else if constexpr (consume || !std::is_copy_constructible_v<T>) {
+                if (auto result = task_.take()) {
+                    return std::move(*result);
+                }
+                return missing_result();
+            } else {
+                if (auto result = task_.get()) {
+                    return std::move(*result);
+                }
+                return missing_result();
+            }
+        }
+    };
+
+    inline awaiter<false> operator co_await() &noexcept { return awaiter<false>{*this}; }
+
+    inline awaiter<true> operator co_await() &&noexcept { return awaiter<true>{*this}; }
+
 public:
     /**
      * C++ boilerplate to disable copy assignement and copy constructor and leave just the move ones.
@@ -88,8 +376,9 @@ public:
 
     single_task &operator=(const single_task &) = delete;
 
-    constexpr inline single_task &operator=(single_task &&other) noexcept {
+    inline single_task &operator=(single_task &&other) noexcept {
         if (&other != this) {
+            destroy();
             handle_ = other.handle_;
             other.handle_ = nullptr;
         }
@@ -105,9 +394,9 @@ private:
     std::coroutine_handle<promise_type> handle_;
 };
 
-template<typename T, bool start_immediately, bool enable_exceptions_propagation>
-struct single_task_promise_type : value_holder<T, enable_exceptions_propagation> {
-    using single_task_t = single_task<T, start_immediately, enable_exceptions_propagation>;
+template<typename T, bool start_immediately, bool enable_exceptions_propagation, typename frame_policy, typename instrumentation>
+struct single_task_promise_type : task_link, value_holder<T, enable_exceptions_propagation>, instrumentation::template frames<frame_policy>, instrumentation {
+    using single_task_t = single_task<T, start_immediately, enable_exceptions_propagation, frame_policy, instrumentation>;
     using value_holder_t = value_holder<T, enable_exceptions_propagation>;
 
 public:
@@ -121,18 +410,19 @@ public:
         if constexpr(start_immediately)
             return std::suspend_never{};
         else
-            return std::suspend_always{};
+            return instrumentation::wrap(std::suspend_always{});
     }
 
-    /* Whether the coroutine suspends itself at the end before destruction. This is done to avoid the coroutine automatic destruction */
-    constexpr static auto final_suspend() noexcept { return std::suspend_always{}; }
+    /* Whether the coroutine suspends itself at the end before destruction. This is done to avoid the coroutine automatic destruction.
+     * The awaiting task, if any, is resumed from there. */
+    constexpr static auto final_suspend() noexcept { return instrumentation::template wrap<true>(final_awaiter{}); }
 
     /* When we return from the coroutine ; called from a co_return  */
     template<typename U = T>
     constexpr void return_value(U &&val) requires (!std::is_void_v<T>) { value_holder_t::set_value(std::forward<U>(val)); }
 
     template<typename U = T>
-    constexpr void return_value(const U &val) requires (!std::is_void_v<T>) { value_holder_t::set_value(std::forward<U>(val)); }
+    constexpr void return_value(const U &val) requires (!std::is_void_v<T>) { value_holder_t::set_value(val); }
 
     constexpr void unhandled_exception() noexcept {
         if constexpr (enable_exceptions_propagation) {
@@ -142,9 +432,10 @@ public:
 
 };
 
-template<bool start_immediately, bool enable_exceptions_propagation>
-struct single_task_promise_type<void, start_immediately, enable_exceptions_propagation> : value_holder<void, enable_exceptions_propagation> {
-    using single_task_t = single_task<void, start_immediately, enable_exceptions_propagation>;
+template<bool start_immediately, bool enable_exceptions_propagation, typename frame_policy, typename instrumentation>
+struct single_task_promise_type<void, start_immediately, enable_exceptions_propagation, frame_policy, instrumentation>
+        : task_link, value_holder<void, enable_exceptions_propagation>, instrumentation::template frames<frame_policy>, instrumentation {
+    using single_task_t = single_task<void, start_immediately, enable_exceptions_propagation, frame_policy, instrumentation>;
     using value_holder_t = value_holder<void, enable_exceptions_propagation>;
 
 public:
@@ -158,11 +449,12 @@ public:
         if constexpr(start_immediately)
             return std::suspend_never{};
         else
-            return std::suspend_always{};
+            return instrumentation::wrap(std::suspend_always{});
     }
 
-    /* Whether the coroutine suspends itself at the end before destruction. This is done to avoid the coroutine automatic destruction */
-    constexpr static auto final_suspend() noexcept { return std::suspend_always{}; }
+    /* Whether the coroutine suspends itself at the end before destruction. This is done to avoid the coroutine automatic destruction.
+     * The awaiting task, if any, is resumed from there. */
+    constexpr static auto final_suspend() noexcept { return instrumentation::template wrap<true>(final_awaiter{}); }
 
     constexpr void unhandled_exception() noexcept {
         if constexpr(enable_exceptions_propagation) {
@@ -186,13 +478,21 @@ static constexpr void static_tests_single_task() {
     static_assert(sizeof(single_task<void, true, false>) == sizeof(std::coroutine_handle<void>));
     static_assert(sizeof(single_task<void, true, true>) == sizeof(std::coroutine_handle<void>));
 
-    static_assert(sizeof(single_task<void, false, false>::promise_type) == 1);
-    static_assert(sizeof(single_task<void, true, false>::promise_type) == 1);
-    static_assert(sizeof(single_task<int, false, false>::promise_type) == sizeof(int));
-    static_assert(sizeof(single_task<int, true, false>::promise_type) == sizeof(int));
-    static_assert(sizeof(single_task<void, false, true>::promise_type) == sizeof(std::exception_ptr));
-    static_assert(sizeof(single_task<void, true, true>::promise_type) == sizeof(std::exception_ptr));
-    static_assert(sizeof(single_task<int, false, true>::promise_type) == sizeof(std::variant<int, std::exception_ptr>));
-    static_assert(sizeof(single_task<int, true, true>::promise_type) == sizeof(std::variant<int, std::exception_ptr>));
+    // The int fits in the tail padding of the link
+    static_assert(sizeof(single_task<void, false, false>::promise_type) == sizeof(task_link));
+    static_assert(sizeof(single_task<void, true, false>::promise_type) == sizeof(task_link));
+    static_assert(sizeof(single_task<int, false, false>::promise_type) == sizeof(task_link));
+    static_assert(sizeof(single_task<int, true, false>::promise_type) == sizeof(task_link));
+    static_assert(sizeof(single_task<void, false, true>::promise_type) == sizeof(task_link) + sizeof(std::exception_ptr));
+    static_assert(sizeof(single_task<void, true, true>::promise_type) == sizeof(task_link) + sizeof(std::exception_ptr));
+    static_assert(sizeof(single_task<int, false, true>::promise_type) == sizeof(task_link) + sizeof(std::variant<int, std::exception_ptr>));
+    static_assert(sizeof(single_task<int, true, true>::promise_type) == sizeof(task_link) + sizeof(std::variant<int, std::exception_ptr>));
+
+    static_assert(sizeof(single_task<void, false, false, heap_frames>::promise_type) == sizeof(task_link));
+    static_assert(sizeof(single_task<int, false, false, heap_frames>::promise_type) == sizeof(task_link));
+
+    static_assert(sizeof(single_task<std::unique_ptr<int>, false, false>::promise_type) == sizeof(task_link) + 2 * sizeof(void *));
+    static_assert(std::is_same_v<decltype(std::declval<single_task<std::unique_ptr<int>> &>().get()), std::unique_ptr<int> *>);
+    static_assert(std::is_same_v<decltype(std::declval<single_task<std::unique_ptr<int>>>().get()), std::optional<std::unique_ptr<int>>>);
 }
 
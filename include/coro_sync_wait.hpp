@@ -0,0 +1,82 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+
+#include <exception>
+#include <optional>
+#include <semaphore>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace detail {
+
+    /**
+     * Coroutine awaiting the task on behalf of sync_wait, it signals the waiting thread from its final suspend.
+     * The semaphore lives with the waiting thread: the frame may be destroyed as soon as it is released.
+     */
+    struct sync_wait_driver {
+        struct promise_type {
+            std::binary_semaphore *done_ = nullptr;
+            std::exception_ptr exception_;
+
+            sync_wait_driver get_return_object() noexcept { return sync_wait_driver{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+
+            static constexpr std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct final_awaiter {
+                static constexpr bool await_ready() noexcept { return false; }
+
+                static inline void await_suspend(std::coroutine_handle<promise_type> self) noexcept { self.promise().done_->release(); }
+
+                static constexpr void await_resume() noexcept {}
+            };
+
+            static constexpr final_awaiter final_suspend() noexcept { return {}; }
+
+            inline void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+            static constexpr void return_void() noexcept {}
+        };
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    /* A temporary task is awaited as such, so that its result is moved out */
+    template<bool returns_void, typename awaitable_t, typename stored_t>
+    sync_wait_driver make_sync_wait_driver(std::remove_reference_t<awaitable_t> &awaitable, std::optional<stored_t> &result) {
+        if constexpr (returns_void) {
+            co_await static_cast<awaitable_t &&>(awaitable);
+        } else {
+            result.emplace(co_await static_cast<awaitable_t &&>(awaitable));
+        }
+    }
+
+}
+
+
+/**
+ * Boundary between coroutines and regular code: blocks the calling thread until the task completes, and returns
+ * its result or rethrows its exception.
+ * The calling thread starts the task and then sleeps, so the task has to complete without being resumed from
+ * outside: it runs to completion inline, or moves to an executor with thread_pool::schedule()...
+ */
+template<typename task_t>
+auto sync_wait(task_t &&task) {
+    using result_t = decltype(std::declval<task_t>().operator co_await().await_resume());
+    using stored_t = std::conditional_t<std::is_void_v<result_t>, std::monostate, result_t>;
+    std::optional<stored_t> result;
+    std::binary_semaphore done{0};
+    auto driver = detail::make_sync_wait_driver<std::is_void_v<result_t>, task_t>(task, result);
+    driver.handle_.promise().done_ = &done;
+    driver.handle_.resume();
+    done.acquire();
+    auto exception = driver.handle_.promise().exception_;
+    driver.handle_.destroy();
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+    if constexpr (!std::is_void_v<result_t>) {
+        return std::move(*result);
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <x86intrin.h>
+
+#endif
+
+/**
+ * Cheap timestamps for throughput sampling: the TSC when available, the steady clock otherwise.
+ * Only ratios of measures taken on the same thread are used, so the unit does not matter.
+ */
+struct tuning_clock {
+    static inline uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+};
+
+/**
+ * Hill climbing on the number of tasks in flight.
+ * Each sample is the throughput (resumes per tick) measured at the current width. The width moves by `step` in the
+ * current direction as long as the throughput improves; otherwise the direction is reversed and the step halved.
+ * Once the step reaches zero the tuner has converged and settles on the best width it has seen.
+ */
+class width_tuner {
+public:
+    explicit width_tuner(size_t initial_width, size_t max_width, size_t window = 1U << 14)
+            : width_(std::clamp<size_t>(initial_width, 1, max_width)), max_width_(max_width), window_(window),
+              step_(std::max<size_t>(1, max_width / 8)), direction_(width_ == max_width ? -1 : 1), best_width_(width_) {}
+
+    [[nodiscard]] inline size_t width() const noexcept { return width_; }
+
+    [[nodiscard]] inline bool converged() const noexcept { return step_ == 0; }
+
+    /* Number of resumes each sample is measured over */
+    [[nodiscard]] inline size_t window() const noexcept { return window_; }
+
+    /* Feeds the throughput measured at the current width, returns the width to use next */
+    size_t on_sample(double throughput) noexcept {
+        if (converged()) {
+            return width_;
+        }
+        if (throughput > best_throughput_) {
+            best_throughput_ = throughput;
+            best_width_ = width_;
+        }
+        if (throughput <= last_throughput_ || at_bound()) {
+            direction_ = -direction_;
+            step_ /= 2;
+        }
+        last_throughput_ = throughput;
+        if (converged()) {
+            width_ = best_width_;
+        } else {
+            auto next = static_cast<ptrdiff_t>(width_) + direction_ * static_cast<ptrdiff_t>(step_);
+            width_ = static_cast<size_t>(std::clamp<ptrdiff_t>(next, 1, static_cast<ptrdiff_t>(max_width_)));
+        }
+        return width_;
+    }
+
+private:
+    [[nodiscard]] inline bool at_bound() const noexcept {
+        return (direction_ > 0 && width_ == max_width_) || (direction_ < 0 && width_ == 1);
+    }
+
+    size_t width_;
+    size_t max_width_;
+    size_t window_;
+    size_t step_;
+    ptrdiff_t direction_;
+    double last_throughput_ = 0;
+    double best_throughput_ = 0;
+    size_t best_width_;
+};
+
+/**
+ * Interleaving engine for latency-bound tasks (pointer chasing, prefetch-and-suspend loops...).
+ * Keeps up to `width()` tasks in flight and resumes the live ones round-robin, so that while one waits for its
+ * memory access the others make progress. When a task finishes, its result is handed to the sink and the slot is
+ * refilled from the input, so the group stays `width()`-wide until the input is drained whatever the task lengths.
+ *
+ * Tasks are stored structure-of-arrays: the handles, the input position that each one was created from, and a
+ * bitmap of the live slots that the resume loop walks.
+ *
+ * The width defaults to `max_width` and can be changed with `set_width()`, or tuned at runtime with `auto_tune()`:
+ * the group then samples its throughput every `window` resumes and lets a width_tuner move the width until it
+ * converges. Slots above the width are drained and not refilled.
+ */
+template<typename task_t, size_t max_width>
+class task_group {
+    static_assert(max_width > 0 && max_width <= 64, "The live slots are tracked in a 64 bits mask");
+
+    using promise_type = typename task_t::promise_type;
+
+public:
+    /**
+     * Creates one task per item with `make_task(item)` and calls `on_result(index, value)` as each of them finishes,
+     * `index` being the position of the item in the input. For tasks returning void, `on_result(index)` is called.
+     * With exceptions propagation enabled, the first exception stops the run and is rethrown, the tasks still in
+     * flight are destroyed with the group.
+     */
+    template<std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel, typename Factory, typename Sink>
+    void run(InputIt first, Sentinel last, Factory &&make_task, Sink &&on_result) {
+        size_t next_index = 0;
+        live_ = 0;
+        auto launch = [&](size_t slot) {
+            while (first != last) {
+                tasks_[slot] = make_task(*first);
+                indices_[slot] = next_index++;
+                ++first;
+                if (!handle(slot).done()) [[likely]] {
+                    live_ |= bit(slot);
+                    return;
+                }
+                collect(slot, on_result); // Started immediately and already done
+            }
+            live_ &= ~bit(slot);
+        };
+
+        auto fill = [&]() {
+            for (size_t slot = 0; slot < width_ && first != last; ++slot) {
+                if (!(live_ & bit(slot))) launch(slot);
+            }
+        };
+
+        fill();
+        size_t sampled_resumes = 0;
+        uint64_t sample_start = tuner_ ? tuning_clock::now() : 0;
+        while (live_) {
+            if (tuner_) {
+                sampled_resumes += static_cast<size_t>(std::popcount(live_));
+            }
+            for (uint64_t pending = live_; pending; pending &= pending - 1) {
+                auto slot = static_cast<size_t>(std::countr_zero(pending));
+                auto h = handle(slot);
+                h.promise().resume_chain(h); // The task may be awaiting a sub-task
+                if (h.done()) {
+                    collect(slot, on_result);
+                    if (slot < width_) launch(slot);
+                    else live_ &= ~bit(slot);
+                }
+            }
+            if (tuner_ && sampled_resumes >= tuner_->window() && first != last) { // The tail of the input is not representative
+                uint64_t sample_end = tuning_clock::now();
+                auto throughput = static_cast<double>(sampled_resumes) / static_cast<double>(std::max<uint64_t>(1, sample_end - sample_start));
+                width_ = tuner_->on_sample(throughput);
+                fill();
+                sampled_resumes = 0;
+                sample_start = sample_end;
+            }
+        }
+    }
+
+    template<std::ranges::input_range Range, typename Factory, typename Sink>
+    void run(Range &&items, Factory &&make_task, Sink &&on_result) {
+        run(std::ranges::begin(items), std::ranges::end(items), std::forward<Factory>(make_task), std::forward<Sink>(on_result));
+    }
+
+    [[nodiscard]] inline size_t in_flight() const noexcept { return static_cast<size_t>(std::popcount(live_)); }
+
+    /* Current number of slots, chosen by the tuner when auto-tuning. Exposed for logging. */
+    [[nodiscard]] inline size_t width() const noexcept { return width_; }
+
+    inline void set_width(size_t width) noexcept {
+        width_ = std::clamp<size_t>(width, 1, max_width);
+        tuner_.reset();
+    }
+
+    /* Lets the group adjust its width while running, starting from the current one */
+    inline void auto_tune(size_t window = 1U << 14) noexcept { tuner_.emplace(width_, max_width, window); }
+
+    [[nodiscard]] inline const std::optional<width_tuner> &tuner() const noexcept { return tuner_; }
+
+    static constexpr size_t capacity() noexcept { return max_width; }
+
+private:
+    inline std::coroutine_handle<promise_type> handle(size_t slot) const noexcept { return tasks_[slot]; }
+
+    static constexpr uint64_t bit(size_t slot) noexcept { return uint64_t{1} << slot; }
+
+    template<typename Sink>
+    inline void collect(size_t slot, Sink &on_result) {
+        if constexpr (std::is_void_v<typename task_t::value_type>) {
+            tasks_[slot].get();
+            on_result(indices_[slot]);
+        } else {
+            on_result(indices_[slot], std::move(*tasks_[slot].take())); // Hands the result over without copying it
+        }
+        tasks_[slot].destroy();
+    }
+
+    std::array<task_t, max_width> tasks_{};
+    std::array<size_t, max_width> indices_{};
+    uint64_t live_ = 0;
+    size_t width_ = max_width;
+    std::optional<width_tuner> tuner_;
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <coro_single_task.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Chase-Lev work-stealing deque of coroutine handles (Lê, Pop, Cohen, Zappa Nardelli, PPoPP'13).
+ * The owner thread pushes and pops at the bottom, LIFO, which keeps the freshly forked work hot in its cache.
+ * Other threads steal from the top. The ring grows when full, the old rings are kept alive until the deque is
+ * destroyed as a thief might still be reading them.
+ */
+class work_stealing_deque {
+public:
+    explicit work_stealing_deque(size_t initial_capacity = 256) {
+        rings_.emplace_back(std::make_unique<ring>(std::bit_ceil(initial_capacity)));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    /* Owner only */
+    void push(std::coroutine_handle<> handle) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        ring *current = ring_.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(current->mask)) {
+            current = grow(current, top, bottom);
+        }
+        current->put(bottom, handle.address());
+        bottom_.store(bottom + 1, std::memory_order_release); // Publishes the item, and the coroutine frame with it
+    }
+
+    /* Owner only */
+    std::coroutine_handle<> pop() noexcept {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        ring *current = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        void *item = nullptr;
+        if (top <= bottom) {
+            item = current->get(bottom);
+            if (top == bottom) { // Last item, race against the thieves
+                if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return std::coroutine_handle<>::from_address(item);
+    }
+
+    /* Any thread */
+    std::coroutine_handle<> steal() noexcept {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top < bottom) {
+            void *item = ring_.load(std::memory_order_acquire)->get(top);
+            if (top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return std::coroutine_handle<>::from_address(item);
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct ring {
+        explicit ring(size_t capacity) : mask(capacity - 1), slots(std::make_unique<std::atomic<void *>[]>(capacity)) {}
+
+        inline void put(int64_t index, void *item) noexcept { slots[static_cast<size_t>(index) & mask].store(item, std::memory_order_relaxed); }
+
+        inline void *get(int64_t index) const noexcept { return slots[static_cast<size_t>(index) & mask].load(std::memory_order_relaxed); }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<void *>[]> slots;
+    };
+
+    ring *grow(ring *current, int64_t top, int64_t bottom) {
+        auto bigger = std::make_unique<ring>(2 * (current->mask + 1));
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, current->get(i));
+        }
+        rings_.emplace_back(std::move(bigger));
+        ring_.store(rings_.back().get(), std::memory_order_release);
+        return rings_.back().get();
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<ring *> ring_{nullptr};
+    std::vector<std::unique_ptr<ring>> rings_; // Owner only
+};
+
+
+/**
+ * Work-stealing thread pool resuming coroutines.
+ * `co_await pool.schedule()` moves the rest of the awaiting coroutine onto the pool: from a worker the coroutine
+ * goes to that worker's deque, from any other thread to a shared injection queue. Idle workers steal from each
+ * other before going to sleep.
+ * A single_task that schedules itself is detached: it must not be resumed from outside anymore, it is awaited
+ * instead, or waited for with sync_wait(). When it is awaited within a chain driven by resume(), resuming the root
+ * of the chain does nothing until it completes, and the awaiting coroutine carries on at the next resume().
+ */
+class thread_pool {
+public:
+    explicit thread_pool(size_t thread_count = std::max(1U, std::thread::hardware_concurrency())) : workers_(thread_count) {
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers_[i].thread = std::thread([this, i]() { run_worker(i); });
+        }
+    }
+
+    thread_pool(const thread_pool &) = delete;
+
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    /* Coroutines still queued are not resumed, their owners destroy them */
+    ~thread_pool() {
+        stop_.store(true, std::memory_order_seq_cst);
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        epoch_.notify_all();
+        for (auto &worker: workers_) {
+            worker.thread.join();
+        }
+    }
+
+    struct schedule_awaiter {
+        thread_pool &pool_;
+
+        static constexpr bool await_ready() noexcept { return false; }
+
+        template<typename promise_t>
+        inline void await_suspend(std::coroutine_handle<promise_t> awaiting) const {
+            if constexpr (std::is_base_of_v<task_link, promise_t>) {
+                awaiting.promise().detach();
+            }
+            pool_.post(awaiting);
+        }
+
+        static constexpr void await_resume() noexcept {}
+    };
+
+    [[nodiscard]] inline schedule_awaiter schedule() noexcept { return schedule_awaiter{*this}; }
+
+    /* Queues a suspended coroutine to be resumed by one of the workers */
+    void post(std::coroutine_handle<> handle) {
+        if (current_pool_ == this) {
+            workers_[current_index_].deque.push(handle);
+        } else {
+            std::lock_guard lock(injection_mutex_);
+            injection_queue_.push_back(handle);
+            injected_.store(true, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            epoch_.notify_one();
+        }
+    }
+
+    [[nodiscard]] inline size_t size() const noexcept { return workers_.size(); }
+
+    /* Whether the calling thread is one of the workers of this pool */
+    [[nodiscard]] inline bool on_worker() const noexcept { return current_pool_ == this; }
+
+private:
+    struct worker {
+        work_stealing_deque deque;
+        std::thread thread;
+    };
+
+    std::coroutine_handle<> find_work(size_t index, uint64_t &seed) {
+        if (auto handle = workers_[index].deque.pop()) {
+            return handle;
+        }
+        if (injected_.load(std::memory_order_relaxed)) {
+            std::lock_guard lock(injection_mutex_);
+            if (!injection_queue_.empty()) {
+                auto handle = injection_queue_.front();
+                injection_queue_.pop_front();
+                injected_.store(!injection_queue_.empty(), std::memory_order_relaxed);
+                return handle;
+            }
+        }
+        seed ^= seed << 13; // xorshift, picks the first victim
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        for (size_t i = 0, count = workers_.size(); i < count; ++i) {
+            size_t victim = (seed + i) % count;
+            if (victim == index) continue;
+            if (auto handle = workers_[victim].deque.steal()) {
+                return handle;
+            }
+        }
+        return nullptr;
+    }
+
+    void run_worker(size_t index) {
+        current_pool_ = this;
+        current_index_ = index;
+        uint64_t seed = 0x9E3779B97F4A7C15ULL * (index + 1);
+        while (!stop_.load(std::memory_order_relaxed)) {
+            if (auto handle = find_work(index, seed)) {
+                handle.resume();
+                continue;
+            }
+            /* Going to sleep: announce it, then look again, so that a post() either sees us or we see its work */
+            auto epoch = epoch_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto handle = find_work(index, seed);
+            if (!handle && !stop_.load(std::memory_order_seq_cst)) {
+                epoch_.wait(epoch, std::memory_order_seq_cst);
+            }
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+            if (handle) {
+                handle.resume();
+            }
+        }
+        current_pool_ = nullptr;
+    }
+
+    std::vector<worker> workers_;
+    std::mutex injection_mutex_;
+    std::deque<std::coroutine_handle<>> injection_queue_;
+    std::atomic<bool> injected_{false};
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<size_t> sleepers_{0};
+    std::atomic<bool> stop_{false};
+
+    static inline thread_local thread_pool *current_pool_ = nullptr;
+    static inline thread_local size_t current_index_ = 0;
+};
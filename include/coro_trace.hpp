@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * What happened to a coroutine frame, and when. Frames are identified by their address, which the frame pool
+ * hands out again once a frame has been destroyed.
+ */
+struct trace_event {
+    enum kind_t : uint8_t {
+        create, // The frame was allocated, `frame_size` is set. A coroutine starting immediately runs from there.
+        suspend,
+        resume,
+        complete, // Final suspend
+        destroy
+    };
+
+    uint64_t time_ns;
+    const void *frame;
+    uint32_t frame_size;
+    kind_t kind;
+};
+
+/**
+ * Fixed size ring of the events recorded by one thread. Only the owning thread writes, without locking; once full,
+ * the oldest events are overwritten.
+ */
+class trace_ring {
+public:
+    static constexpr size_t capacity = 1U << 16;
+
+    explicit trace_ring(uint32_t thread_index) : events_(std::make_unique<trace_event[]>(capacity)), thread_index_(thread_index) {}
+
+    inline void push(const trace_event &event) noexcept {
+        auto head = head_.load(std::memory_order_relaxed);
+        events_[head & (capacity - 1)] = event;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    /* The events still in the ring, oldest first */
+    [[nodiscard]] std::vector<trace_event> snapshot() const {
+        auto head = head_.load(std::memory_order_acquire);
+        auto count = std::min<uint64_t>(head, capacity);
+        std::vector<trace_event> out;
+        out.reserve(count);
+        for (auto i = head - count; i < head; ++i) {
+            out.push_back(events_[i & (capacity - 1)]);
+        }
+        return out;
+    }
+
+    /* Events overwritten before being dumped */
+    [[nodiscard]] inline uint64_t dropped() const noexcept {
+        auto head = head_.load(std::memory_order_acquire);
+        return head > capacity ? head - capacity : 0;
+    }
+
+    inline void clear() noexcept { head_.store(0, std::memory_order_release); }
+
+    [[nodiscard]] inline uint32_t thread_index() const noexcept { return thread_index_; }
+
+private:
+    std::unique_ptr<trace_event[]> events_;
+    std::atomic<uint64_t> head_{0};
+    uint32_t thread_index_;
+};
+
+/**
+ * The rings of all the threads that recorded events. A thread registers its ring on its first event; the rings
+ * outlive their threads so that the trace can be dumped once the workers are gone.
+ *
+ * Dumping and clearing read the rings of the other threads: do it while no traced coroutine is running.
+ */
+class trace_log {
+public:
+    static inline void record(trace_event::kind_t kind, const void *frame, size_t frame_size = 0) noexcept {
+        local().push(trace_event{now(), frame, static_cast<uint32_t>(frame_size), kind});
+    }
+
+    /* Events recorded by the calling thread, oldest first */
+    static std::vector<trace_event> local_events() { return local().snapshot(); }
+
+    static void clear() {
+        std::lock_guard lock(mutex_);
+        for (auto &ring: rings()) {
+            ring->clear();
+        }
+    }
+
+    /**
+     * Chrome trace-event JSON, to open in chrome://tracing or Perfetto. Each thread shows the slices during which a
+     * coroutine was running, from its creation or resume to its next suspend or completion, and each frame gets an
+     * async track from its creation to its destruction, with its size.
+     */
+    static void write_chrome_trace(std::ostream &out) {
+        std::lock_guard lock(mutex_);
+        uint64_t epoch = UINT64_MAX;
+        std::vector<std::pair<uint32_t, std::vector<trace_event>>> threads;
+        for (auto &ring: rings()) {
+            threads.emplace_back(ring->thread_index(), ring->snapshot());
+            for (auto &event: threads.back().second) {
+                epoch = std::min(epoch, event.time_ns);
+            }
+        }
+
+        bool first = true;
+        auto begin_event = [&]() -> std::ostream & {
+            out << (first ? "\n" : ",\n") << R"(    {"cat":"coroutine","pid":0)";
+            first = false;
+            return out;
+        };
+        auto timestamp = [&](uint64_t time_ns) { return static_cast<double>(time_ns - epoch) / 1000.0; };
+        auto frame_id = [](const void *frame) { return reinterpret_cast<uintptr_t>(frame); };
+
+        auto flags = out.flags();
+        out << std::fixed << std::setprecision(3) << R"({"displayTimeUnit":"ns","traceEvents":[)";
+        for (auto &[tid, events]: threads) {
+            std::unordered_map<const void *, uint64_t> running_since;
+            for (auto &event: events) {
+                switch (event.kind) {
+                    case trace_event::create:
+                        begin_event() << R"(,"tid":)" << tid << R"(,"ph":"b","name":"frame","id":)" << frame_id(event.frame)
+                                      << R"(,"ts":)" << timestamp(event.time_ns) << R"(,"args":{"size":)" << event.frame_size << "}}";
+                        running_since[event.frame] = event.time_ns;
+                        break;
+                    case trace_event::resume:
+                        running_since[event.frame] = event.time_ns;
+                        break;
+                    case trace_event::suspend:
+                    case trace_event::complete:
+                        if (auto it = running_since.find(event.frame); it != running_since.end()) {
+                            begin_event() << R"(,"tid":)" << tid << R"(,"ph":"X","name":")" << (event.kind == trace_event::complete ? "completed" : "suspended")
+                                          << R"(","ts":)" << timestamp(it->second) << R"(,"dur":)" << timestamp(event.time_ns) - timestamp(it->second)
+                                          << R"(,"args":{"frame":)" << frame_id(event.frame) << "}}";
+                            running_since.erase(it);
+                        }
+                        break;
+                    case trace_event::destroy:
+                        begin_event() << R"(,"tid":)" << tid << R"(,"ph":"e","name":"frame","id":)" << frame_id(event.frame)
+                                      << R"(,"ts":)" << timestamp(event.time_ns) << "}";
+                        break;
+                }
+            }
+        }
+        out << "\n]}\n";
+        out.flags(flags);
+    }
+
+private:
+    static inline uint64_t now() noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static inline trace_ring &local() {
+        static thread_local trace_ring *ring = register_thread();
+        return *ring;
+    }
+
+    static trace_ring *register_thread() {
+        std::lock_guard lock(mutex_);
+        auto &all = rings();
+        all.push_back(std::make_unique<trace_ring>(static_cast<uint32_t>(all.size())));
+        return all.back().get();
+    }
+
+    /* Never destroyed, threads may still record while the program exits */
+    static inline std::vector<std::unique_ptr<trace_ring>> &rings() {
+        static auto *all = new std::vector<std::unique_ptr<trace_ring>>();
+        return *all;
+    }
+
+    static inline std::mutex mutex_;
+};
+
+
+/**
+ * Wraps the awaiters of a traced coroutine to record its suspensions and resumptions. `completes` marks the final
+ * suspend. The typed handle is passed through, so awaiters that look into the promise of their caller still work.
+ */
+template<typename awaiter_t, bool completes = false>
+struct traced_awaiter {
+    awaiter_t awaiter_;
+    const void *frame_ = nullptr;
+
+    inline bool await_ready() noexcept(noexcept(std::declval<awaiter_t &>().await_ready())) { return awaiter_.await_ready(); }
+
+    template<typename promise_t>
+    inline decltype(auto) await_suspend(std::coroutine_handle<promise_t> self) noexcept(noexcept(std::declval<awaiter_t &>().await_suspend(self))) {
+        frame_ = self.address();
+        trace_log::record(completes ? trace_event::complete : trace_event::suspend, frame_); // The coroutine may run elsewhere once handed over
+        return awaiter_.await_suspend(self);
+    }
+
+    inline decltype(auto) await_resume() noexcept(noexcept(std::declval<awaiter_t &>().await_resume())) {
+        if constexpr (!completes) {
+            if (frame_) {
+                trace_log::record(trace_event::resume, frame_);
+            }
+        }
+        return awaiter_.await_resume();
+    }
+};
+
+/**
+ * Frame policy wrapper recording the creation and destruction of the frames, with their size. The allocation itself
+ * is left to the wrapped policy, its allocator arguments included.
+ */
+template<typename frame_policy>
+struct traced_frames : frame_policy {
+    static void *operator new(size_t size) {
+        void *frame;
+        if constexpr (requires { frame_policy::operator new(size); }) {
+            frame = frame_policy::operator new(size);
+        } else {
+            frame = ::operator new(size);
+        }
+        trace_log::record(trace_event::create, frame, size);
+        return frame;
+    }
+
+    /* For policies taking the coroutine arguments, such as an allocator */
+    template<typename... Args>
+    requires(sizeof...(Args) > 0 && requires(size_t size, Args &...args) { frame_policy::operator new(size, args...); })
+    static void *operator new(size_t size, Args &...args) {
+        void *frame = frame_policy::operator new(size, args...);
+        trace_log::record(trace_event::create, frame, size);
+        return frame;
+    }
+
+    static void operator delete(void *ptr, size_t size) noexcept {
+        trace_log::record(trace_event::destroy, ptr);
+        if constexpr (requires { frame_policy::operator delete(ptr, size); }) {
+            frame_policy::operator delete(ptr, size);
+        } else {
+            ::operator delete(ptr, size);
+        }
+    }
+};
+
+
+/**
+ * Instrumentation policies, inherited by the promise types of single_task and generator.
+ *
+ * `untraced` is the default and compiles to nothing: the frame policy is used as is and the awaiters are left alone.
+ * `traced` records the lifetime of every frame in the trace_log: creation and size, suspensions, resumptions,
+ * completion and destruction. It sees the co_await expressions of the coroutine body through await_transform.
+ */
+struct untraced {
+    static constexpr bool enabled = false;
+
+    template<typename frame_policy>
+    using frames = frame_policy;
+
+    template<bool completes = false, typename awaiter_t>
+    static constexpr awaiter_t &&wrap(awaiter_t &&awaiter) noexcept { return std::forward<awaiter_t>(awaiter); }
+};
+
+struct traced {
+    static constexpr bool enabled = true;
+
+    template<typename frame_policy>
+    using frames = traced_frames<frame_policy>;
+
+    template<bool completes = false, typename awaiter_t>
+    static constexpr traced_awaiter<awaiter_t, completes> wrap(awaiter_t &&awaiter) noexcept(std::is_nothrow_constructible_v<awaiter_t, awaiter_t &&>) {
+        return {std::forward<awaiter_t>(awaiter)};
+    }
+
+    template<typename awaitable_t>
+    inline auto await_transform(awaitable_t &&awaitable) {
+        if constexpr (requires { std::forward<awaitable_t>(awaitable).operator co_await(); }) {
+            return wrap(std::forward<awaitable_t>(awaitable).operator co_await());
+        } else if constexpr (requires { operator co_await(std::forward<awaitable_t>(awaitable)); }) {
+            return wrap(operator co_await(std::forward<awaitable_t>(awaitable)));
+        } else {
+            return wrap(std::forward<awaitable_t>(awaitable));
+        }
+    }
+};
+
+
+static constexpr void static_tests_trace() {
+    static_assert(std::is_empty_v<untraced> && std::is_empty_v<traced>);
+    static_assert(std::is_same_v<untraced::frames<int>, int>);
+    static_assert(sizeof(trace_event) == 3 * sizeof(uint64_t));
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <coro_event_pipeline.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/* A single_task, or any task whose promise is a link of a task chain */
+template<typename task_t>
+concept linked_task = requires {
+    typename std::remove_cvref_t<task_t>::promise_type;
+    typename std::remove_cvref_t<task_t>::value_type;
+} && std::derived_from<typename std::remove_cvref_t<task_t>::promise_type, task_link>;
+
+namespace when_detail {
+
+    template<typename task_t>
+    using value_t = typename std::remove_cvref_t<task_t>::value_type;
+
+    template<typename task_t>
+    using result_t = std::conditional_t<std::is_void_v<value_t<task_t>>, std::monostate, value_t<task_t>>;
+
+    /* Moves the result out of the tasks owned by the group, and reads it as `co_await task` does otherwise */
+    template<bool consume, typename task_t>
+    inline result_t<task_t> take_result(task_t &task) {
+        if constexpr (std::is_void_v<value_t<task_t>>) {
+            task.get(); // Rethrows
+            return {};
+        } else if constexpr (consume || !std::is_copy_constructible_v<value_t<task_t>>) {
+            if (auto result = task.take()) {
+                return std::move(*result);
+            }
+            return task.missing_result();
+        } else {
+            if (auto result = task.get()) {
+                return std::move(*result);
+            }
+            return task.missing_result();
+        }
+    }
+
+    /* Root of the chain of the awaiting coroutine if that chain is driven from outside, nullptr otherwise */
+    template<typename promise_t>
+    inline task_link *driven_root(std::coroutine_handle<promise_t> awaiting) noexcept {
+        if constexpr (std::is_base_of_v<task_link, promise_t>) {
+            auto &root = task_link::chain_root(awaiting.promise());
+            return root.driven_chain() ? &root : nullptr;
+        } else {
+            return nullptr;
+        }
+    }
+
+    /* A task of a group, whatever its type */
+    struct child {
+        task_link *link = nullptr; // nullptr for an empty task, which counts as completed
+        std::coroutine_handle<> handle{};
+        pending_wait wait{}; // In a pipeline: what the task is suspended on
+        bool linked = false;
+
+        template<typename task_t>
+        explicit child(task_t &task) noexcept {
+            if (auto h = static_cast<std::coroutine_handle<typename task_t::promise_type>>(task)) {
+                link = &h.promise();
+                handle = h;
+            }
+        }
+
+        [[nodiscard]] inline bool completed() const noexcept { return !link || link->completed(handle); }
+
+        [[nodiscard]] inline bool driven() const noexcept { return link && !link->detached_; }
+    };
+
+    /**
+     * The tasks awaited together, until all of them have completed or, with `any`, one of them.
+     *
+     * Outside of an event_pipeline, each task is linked to the awaiting coroutine and the tasks not detached are
+     * resumed, so that lazy tasks start. They share an atomic countdown, from the number of tasks to wait for plus
+     * one held while linking: the task that brings it to zero resumes the awaiting coroutine, or no one if linking
+     * finishes last and the coroutine does not suspend. With `any`, the countdown starts at 2 and goes on below zero,
+     * unsigned, so that only the first completion resumes. Tasks detached to an executor complete on their own, the
+     * others complete on the thread that resumes them.
+     *
+     * When the chain of the awaiting coroutine is driven from outside, the group becomes its leaf: resuming the root
+     * resumes the tasks that suspended on their own, holding the countdown meanwhile, and then the awaiting coroutine
+     * if they are done. Detached tasks do not count down then, as their executor would resume the awaiting coroutine
+     * behind the back of the driver: the group counts them down once it sees them completed.
+     *
+     * In an event_pipeline, each task runs under a wait of its own instead, and the group is the pollable event of
+     * the awaiting task: polling it resumes the tasks whose event has completed.
+     */
+    template<bool any>
+    class group : private chain_fork {
+    public:
+        explicit group(std::span<child> children) noexcept: chain_fork{&resume_fork}, children_(children) {}
+
+        group(const group &) = delete;
+
+        group &operator=(const group &) = delete;
+
+        [[nodiscard]] inline bool ready() const noexcept {
+            if constexpr (any) {
+                return std::ranges::any_of(children_, &child::completed);
+            } else {
+                return std::ranges::all_of(children_, &child::completed);
+            }
+        }
+
+        /* Returns whether the awaiting coroutine stays suspended. `root` is the root of its chain if it is driven */
+        bool start(std::coroutine_handle<> awaiting, task_link *root) {
+            awaiting_ = awaiting;
+            if (auto *wait = pending_wait::current) {
+                return start_polled(*wait);
+            }
+            return start_linked(root);
+        }
+
+        /* Gives a driven chain its leaf back. With `any`, unlinks the tasks still running and waits for those completing right now to count down */
+        void finish() noexcept {
+            if (root_) {
+                root_->restore_leaf(previous_leaf_);
+            }
+            if constexpr (any) {
+                if (!linked_) return; // Ready without suspending, or polled: nothing counts down
+                size_t count_downs = 1 + unlinked_count_downs_;
+                for (auto &c: children_) {
+                    if (c.linked && !c.link->leave_group(awaiting_, c.handle) && (c.driven() || !root_)) {
+                        ++count_downs; // Not a detached task of a driven group, which does not count down itself
+                    }
+                    c.linked = false;
+                }
+                while (countdown_.load(std::memory_order_acquire) != 2 - count_downs) {
+                    std::this_thread::yield(); // A detached task between its completion and its count down
+                }
+            }
+        }
+
+        /* The first completed task, by position */
+        [[nodiscard]] inline size_t first_completed() const noexcept {
+            return static_cast<size_t>(std::ranges::find_if(children_, &child::completed) - children_.begin());
+        }
+
+    private:
+        bool start_linked(task_link *root) {
+            linked_ = true;
+            countdown_.store((any ? 1 : children_.size()) + 1, std::memory_order_relaxed);
+            for (auto &c: children_) {
+                if (!c.completed() && c.link->join_group(awaiting_, countdown_, root != nullptr)) {
+                    c.linked = true;
+                    if (c.driven()) {
+                        c.link->resume_chain(c.handle);
+                    }
+                    if (any && c.driven() && c.completed()) break; // Counted down on completion
+                    continue;
+                }
+                ++unlinked_count_downs_;
+                countdown_.fetch_sub(1, std::memory_order_acq_rel); // Completed already: never the last count down
+                if (any) break;
+            }
+            if (root) {
+                root_ = root;
+                previous_leaf_ = root->fork_leaf(*this); // Restored by finish(), whoever resumes the awaiting coroutine
+            }
+            return countdown_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+
+        /* Resumes the tasks of the group from the root of a driven chain, and the awaiting coroutine once they are done */
+        void drive() {
+            countdown_.fetch_add(1, std::memory_order_relaxed); // Held: no task resumes the awaiting coroutine meanwhile
+            for (auto &c: children_) {
+                if (c.linked && !c.driven() && c.completed()) {
+                    c.linked = false; // Detached, completed without counting down
+                    ++unlinked_count_downs_;
+                    countdown_.fetch_sub(1, std::memory_order_acq_rel);
+                } else if (c.linked && c.driven() && !c.completed()) {
+                    c.link->resume_chain(c.handle);
+                }
+                if (any && c.completed()) break;
+            }
+            if (countdown_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                awaiting_.resume(); // The group may be gone afterwards
+            }
+        }
+
+        static void resume_fork(chain_fork &fork) {
+            static_cast<group &>(fork).drive();
+        }
+
+        bool start_polled(pending_wait &wait) {
+            for (auto &c: children_) {
+                if (c.driven() && !c.completed()) {
+                    resume(c);
+                }
+                if (any && c.completed()) break;
+            }
+            if (ready()) {
+                return false;
+            }
+            wait.event = this;
+            wait.is_complete = [](const void *g) -> bool { return static_cast<const group *>(g)->poll(); };
+            return true;
+        }
+
+        bool poll() const {
+            for (auto &c: children_) {
+                if (c.driven() && !c.completed() && c.wait.ready()) {
+                    resume(c);
+                    if (any && c.completed()) return true;
+                }
+            }
+            return ready();
+        }
+
+        /* Runs a task under its own wait, restoring the wait of the awaiting task */
+        static void resume(child &c) {
+            auto *previous = std::exchange(pending_wait::current, &c.wait);
+            c.wait = {};
+            c.link->resume_chain(c.handle);
+            pending_wait::current = previous;
+        }
+
+        std::span<child> children_;
+        std::coroutine_handle<> awaiting_{};
+        std::atomic<size_t> countdown_{0};
+        size_t unlinked_count_downs_ = 0;
+        task_link *root_ = nullptr; // Root of the driven chain the group is the leaf of
+        void *previous_leaf_ = nullptr;
+        bool linked_ = false;
+    };
+
+    /* A fixed set of tasks, owned when passed as temporaries */
+    template<bool any, typename... tasks_t>
+    class tuple_awaiter {
+    public:
+        explicit tuple_awaiter(tasks_t &&...tasks)
+                : tasks_(std::forward<tasks_t>(tasks)...),
+                  children_(std::apply([](auto &...task) { return std::array<child, sizeof...(tasks_t)>{child(task)...}; }, tasks_)),
+                  group_(children_) {}
+
+        [[nodiscard]] inline bool await_ready() const noexcept { return group_.ready(); }
+
+        template<typename promise_t>
+        inline bool await_suspend(std::coroutine_handle<promise_t> awaiting) { return group_.start(awaiting, driven_root(awaiting)); }
+
+        auto await_resume() {
+            group_.finish();
+            if constexpr (any) {
+                return take_first(std::index_sequence_for<tasks_t...>{});
+            } else {
+                return take_all(std::index_sequence_for<tasks_t...>{});
+            }
+        }
+
+    private:
+        template<size_t... I>
+        inline std::tuple<result_t<tasks_t>...> take_all(std::index_sequence<I...>) {
+            return {take_result<!std::is_reference_v<tasks_t>>(std::get<I>(tasks_))...}; // In order
+        }
+
+        template<size_t... I>
+        inline std::pair<size_t, std::variant<result_t<tasks_t>...>> take_first(std::index_sequence<I...>) {
+            size_t index = group_.first_completed();
+            std::optional<std::variant<result_t<tasks_t>...>> result;
+            ((I == index && (result.emplace(std::in_place_index<I>, take_result<false>(std::get<I>(tasks_))), true)) || ...);
+            return {index, std::move(*result)};
+        }
+
+        std::tuple<tasks_t...> tasks_;
+        std::array<child, sizeof...(tasks_t)> children_;
+        group<any> group_;
+    };
+
+    /* Any number of tasks of the same type, the range being owned when passed as a temporary */
+    template<bool any, typename range_t>
+    class range_awaiter {
+        using task_t = std::ranges::range_value_t<std::remove_reference_t<range_t>>;
+        static constexpr bool owned = !std::is_reference_v<range_t>;
+
+    public:
+        explicit range_awaiter(range_t &&tasks) : tasks_(std::forward<range_t>(tasks)), children_(make_children(tasks_)), group_(children_) {}
+
+        [[nodiscard]] inline bool await_ready() const noexcept { return group_.ready(); }
+
+        template<typename promise_t>
+        inline bool await_suspend(std::coroutine_handle<promise_t> awaiting) { return group_.start(awaiting, driven_root(awaiting)); }
+
+        auto await_resume() {
+            group_.finish();
+            if constexpr (any) {
+                size_t index = group_.first_completed();
+                auto it = std::ranges::begin(tasks_);
+                std::ranges::advance(it, static_cast<std::ranges::range_difference_t<range_t>>(index));
+                return std::pair<size_t, result_t<task_t>>(index, take_result<false>(*it));
+            } else {
+                std::vector<result_t<task_t>> results;
+                results.reserve(children_.size());
+                for (auto &task: tasks_) {
+                    results.push_back(take_result<owned>(task));
+                }
+                return results;
+            }
+        }
+
+    private:
+        static std::vector<child> make_children(std::remove_reference_t<range_t> &tasks) {
+            std::vector<child> children;
+            for (auto &task: tasks) {
+                children.emplace_back(task);
+            }
+            return children;
+        }
+
+        range_t tasks_;
+        std::vector<child> children_;
+        group<any> group_;
+    };
+}
+
+
+/**
+ * `auto [a, b] = co_await when_all(task_a(), task_b());` suspends until all the tasks have completed, and returns
+ * their results in order, std::monostate for void tasks. Temporary tasks are owned by the awaiter and their results
+ * moved out, other tasks are read as `co_await task` would. The range form returns a std::vector of the results.
+ *
+ * Lazy tasks are started, one after the other, and run until they suspend. Like `co_await task`, awaiting resumes a
+ * task that is not detached: the tasks have to be lazy, completed, or detached to an executor such as a
+ * thread_pool, which then completes them concurrently. The last task to complete resumes the awaiting coroutine,
+ * on its own thread. In a chain driven by resume(), resuming it resumes the tasks that suspended on their own, and
+ * detached tasks are waited for across resumes instead, never resuming the awaiting coroutine themselves. In an
+ * event_pipeline, the tasks suspended on pollable events are polled with the awaiting task.
+ *
+ * Nothing is allocated per task: the tasks share one atomic countdown. With exceptions propagation, the first
+ * exception in the order of the tasks is rethrown once all of them have completed.
+ */
+template<linked_task... tasks_t>
+requires(sizeof...(tasks_t) > 0)
+[[nodiscard]] inline auto when_all(tasks_t &&...tasks) {
+    return when_detail::tuple_awaiter<false, tasks_t...>(std::forward<tasks_t>(tasks)...);
+}
+
+template<std::ranges::forward_range range_t>
+requires(linked_task<std::ranges::range_value_t<range_t>>)
+[[nodiscard]] inline auto when_all(range_t &&tasks) {
+    return when_detail::range_awaiter<false, range_t>(std::forward<range_t>(tasks));
+}
+
+/**
+ * `auto [index, result] = co_await when_any(task_a, task_b);` suspends until one of the tasks completes, and
+ * returns its position and its result, as a std::variant over the results of the tasks. If several tasks have
+ * completed by then, the first one by position is returned. Its exception is rethrown if it failed.
+ *
+ * Tasks cannot be cancelled: the others go on running, unlinked from the awaiting coroutine, so they are passed by
+ * reference and kept alive by the caller until they complete. The range form returns the result itself and
+ * throws std::invalid_argument on an empty range. See when_all() for how the tasks are run.
+ */
+template<linked_task... tasks_t>
+requires(sizeof...(tasks_t) > 0 && (std::is_lvalue_reference_v<tasks_t> && ...))
+[[nodiscard]] inline auto when_any(tasks_t &&...tasks) {
+    return when_detail::tuple_awaiter<true, tasks_t...>(std::forward<tasks_t>(tasks)...);
+}
+
+template<std::ranges::forward_range range_t>
+requires(linked_task<std::ranges::range_value_t<range_t>> && std::is_lvalue_reference_v<range_t>)
+[[nodiscard]] inline auto when_any(range_t &&tasks) {
+    if (std::ranges::empty(tasks)) {
+        throw std::invalid_argument("No task to wait for in when_any.");
+    }
+    return when_detail::range_awaiter<true, range_t>(std::forward<range_t>(tasks));
+}
+
+
+static constexpr void static_tests_when_all() {
+    static_assert(linked_task<single_task<int>>);
+    static_assert(linked_task<single_task<void, false> &>);
+    static_assert(!linked_task<int>);
+    static_assert(std::is_same_v<when_detail::result_t<single_task<void>>, std::monostate>);
+}
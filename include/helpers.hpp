@@ -3,6 +3,8 @@
 #include <type_traits>
 #include <variant>
 #include <exception>
+#include <cstdint>
+#include <memory>
 
 struct empty_storage_struct {
 };
@@ -34,21 +36,132 @@ constexpr void check_type_helpers() {
     static_assert(sizeof(optional_type_t<float, false>) == 1);
 }
 
+/**
+ * Result storage of the promises. The value, or the exception, is constructed in place when the coroutine returns
+ * or yields, so `T` needs neither a default constructor nor a copy constructor, and it can be moved out once.
+ * The state is only tracked when something has to be destroyed or told apart: without exceptions and for a
+ * trivially destructible, nothrow default constructible `T`, the holder is just the storage of a `T`, value
+ * initialized upfront so that a coroutine ending without a value still leaves one to read.
+ */
 template<typename T, bool enable_exceptions_propagation>
 struct value_holder {
+    static constexpr bool tracks_state = enable_exceptions_propagation || !std::is_trivially_destructible_v<T> || !std::is_nothrow_default_constructible_v<T>;
+
+    enum class state_t : uint8_t {
+        empty, value, exception
+    };
+
 public:
+    value_holder() noexcept {
+        if constexpr (!tracks_state) {
+            std::construct_at(&storage_.value);
+        }
+    }
+
+    value_holder(const value_holder &) = delete;
+
+    value_holder &operator=(const value_holder &) = delete;
+
+    ~value_holder() noexcept {
+        reset();
+    }
+
     void set_exception(const std::exception_ptr &ptr) noexcept requires(enable_exceptions_propagation) {
-        return_value_ = ptr;
+        reset();
+        std::construct_at(&storage_.exception_ptr, ptr);
+        state_ = state_t::exception;
     }
 
     template<typename U = T>
     inline constexpr void set_value(U &&val) {
-        return_value_ = std::forward<U>(val);
+        reset();
+        std::construct_at(&storage_.value, std::forward<U>(val));
+        if constexpr (tracks_state) {
+            state_ = state_t::value;
+        }
     }
 
-    template<typename U = T>
-    inline constexpr void set_value(const U &val) {
-        return_value_ = val;
+    [[nodiscard]] inline std::exception_ptr get_exception_ptr() const noexcept {
+        if constexpr (enable_exceptions_propagation) {
+            if (state_ != state_t::exception) {
+                return nullptr;
+            }
+            return storage_.exception_ptr;
+        } else {
+            return nullptr;
+        }
+    }
+
+    /* False when the coroutine ended without storing a value: an exception was swallowed, or it was taken */
+    [[nodiscard]] inline bool has_value() const noexcept {
+        if constexpr (tracks_state) {
+            return state_ == state_t::value;
+        } else {
+            return true;
+        }
+    }
+
+    constexpr T const &get_value() const noexcept {
+        return storage_.value;
+    }
+
+    constexpr T &get_value() noexcept {
+        return storage_.value;
+    }
+
+    /* Moves the value out and destroys what is left of it */
+    inline T take_value() noexcept(std::is_nothrow_move_constructible_v<T>) {
+        T value(std::move(storage_.value));
+        reset();
+        return value;
+    }
+
+private:
+    inline void reset() noexcept {
+        if constexpr (tracks_state) {
+            if (state_ == state_t::value) {
+                std::destroy_at(&storage_.value);
+            } else if constexpr (enable_exceptions_propagation) {
+                if (state_ == state_t::exception) {
+                    std::destroy_at(&storage_.exception_ptr);
+                }
+            }
+            state_ = state_t::empty;
+        }
+    }
+
+    /* Distinct empty types: two empty members of the same type, here or in the promise, cannot share an address */
+    struct no_exception {
+    };
+
+    struct untracked_state {
+    };
+
+    union storage_t {
+        storage_t() noexcept {}
+
+        ~storage_t() noexcept {}
+
+        T value;
+        conditional_type_t<std::exception_ptr, no_exception, enable_exceptions_propagation> exception_ptr;
+    } storage_;
+
+    [[no_unique_address]] conditional_type_t<state_t, untracked_state, tracks_state> state_{};
+};
+
+/**
+ * Yield-by-reference: only a pointer to the yielded object is kept, the object itself stays where the coroutine
+ * put it (its frame, or the temporary of the co_yield expression) until the coroutine is resumed.
+ */
+template<typename T, bool enable_exceptions_propagation>
+struct value_holder<T &, enable_exceptions_propagation> {
+public:
+    void set_exception(const std::exception_ptr &ptr) noexcept requires(enable_exceptions_propagation) {
+        return_value_ = ptr;
+    }
+
+    inline constexpr void set_value(T &val) noexcept {
+        return_value_ = std::addressof(val);
     }
 
     [[nodiscard]] inline std::exception_ptr get_exception_ptr() const noexcept {
@@ -62,17 +175,17 @@ public:
         }
     }
 
-    constexpr T const &get_value() const noexcept {
+    constexpr T &get_value() const noexcept {
         if constexpr(enable_exceptions_propagation) {
-            return std::get<T>(return_value_);
+            return *std::get<T *>(return_value_);
         } else {
-            return return_value_;
+            return *return_value_;
         }
     }
 
 private:
-    using storage_t = conditional_type_t<std::variant<T, std::exception_ptr>, T, enable_exceptions_propagation>;
-    storage_t return_value_;
+    using storage_t = conditional_type_t<std::variant<T *, std::exception_ptr>, T *, enable_exceptions_propagation>;
+    storage_t return_value_{};
 };
 
 template<>
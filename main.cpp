@@ -1,16 +1,9 @@
 #include <iostream>
 #include <numeric>
+#include <ranges>
 #include <cassert>
 #include <coro>
 
-template<typename T>
-generator<T, true> range(T begin, T end, T step = 1) {
-    if (step == 0) throw std::runtime_error("Step set to 0 in range."s);
-    for (T i = begin; i < end; i += step) {
-        co_yield i; // == co_await p.yield_value(e);
-    }
-}
-
 template<typename T>
 generator<T, true> linspace(T begin, T end, T num = 1) noexcept {
     if (num == 0) {
@@ -72,7 +65,10 @@ int main() {
     auto float_range = range<float>(0, 100, 0.5);
     std::cout << std::accumulate(float_range.begin(), float_range.end(), 0) << std::endl;
 
-    //    std::ranges::sort(std::vector(10, 1));
+    for (auto i: range<int>(0, 100) | std::views::filter([](int i) { return i % 7 == 0; }) | std::views::take(5)) {
+        std::cout << i << std::endl;
+    }
+
     auto gen = slow_function();
     for (auto i = gen(); !i; i = gen())
         std::cout << "Result not ready" << std::endl;
@@ -8,70 +8,74 @@
  */
 
 #include <iostream>
-#include <deque>
+#include <cerrno>
+#include <cstring>
 #include <coro>
+#include <fcntl.h>
 #include <sycl/sycl.hpp>
  
 /* See <coro> for more */ 
 template<typename T = void>
 using sycl_task = single_task<T, true, true>; // begin coroutine immediately + exceptions
 
-template <typename T = void>
-using sycl_pipeline = std::deque<sycl_task<T>>;
-
-
 /**
- * Blocks on the oldest element of the pipeline to get a result, might return std::nullopt if the oldest job isn't done.
+ * Makes SYCL events pollable: a pipeline resumes a task only once the event it awaits has completed,
+ * so a slow job does not stall the others.
  */
-template<typename T>
-auto advance_pipeline(sycl_pipeline<T> &work_pipeline) -> std::optional<T> {
-    for (auto& item : work_pipeline) {
-        item.resume(); /* Everyone moves forward */
-    }
-    /* Each call to resume will result in a wait on the event that was in the co_await */
-    if (auto result = work_pipeline.front().get()) {
-        work_pipeline.pop_front(); /* Returning the first ready result */
-        return result;
+struct sycl_event {
+    sycl::event event;
+
+    bool is_complete() const {
+        return event.get_info<sycl::info::event::command_execution_status>() == sycl::info::event_command_status::complete;
     }
-    return {};
-}
+};
+
+template<typename T = void>
+using sycl_pipeline = event_pipeline<sycl_task<T>, delivery::completion_order>;
 
 
 /**
  * sycl_task<T> runs until the first co_await/return and propagates exceptions
  * When co_await returns, the event has finished.
  */
-auto sycl_task_flow_example(unsigned in, sycl::queue q) -> sycl_task<unsigned> {
+auto sycl_task_flow_example(unsigned in, sycl::queue q, int data_fd) -> sycl_task<unsigned> {
     auto *dev_ptr = sycl::malloc_device<unsigned>(1U, q);
     /* Set up the context of the computation, heavy */
-    co_await q.copy(&in, dev_ptr, 1U);
-    co_await q.single_task([=]() { *dev_ptr += 1U; }); /* STAGE 1: Computation launched in background */
-    unsigned i = rand() >> 20; /* Get some data from a file? */
+    co_await wait_for(sycl_event{q.copy(&in, dev_ptr, 1U)});
+    co_await wait_for(sycl_event{q.single_task([=]() { *dev_ptr += 1U; })}); /* STAGE 1: Computation launched in background */
+    unsigned i = 0;
+    co_await async_read(data_fd, std::as_writable_bytes(std::span(&i, 1)), in * sizeof(i)); /* Get some data from a file, the pipeline polls the read too */
+    i >>= 20;
     auto evt = q.single_task([=]() { *dev_ptr *= 2U + i; });
-    co_await q.copy(dev_ptr, &in, 1U, evt); /* STAGE 2: Finishing the computation */
+    co_await wait_for(sycl_event{q.copy(dev_ptr, &in, 1U, evt)}); /* STAGE 2: Finishing the computation */
     sycl::free(dev_ptr, q);
     co_return (in / (2U + i)) - 1U; /* Should return 'in' */
 }
 
 
 int main() {
-    /* Something where we will store the coroutines */ 
-    auto work_pipeline = sycl_pipeline<unsigned>{};
+    /* Something where we will store the coroutines, at most 8 jobs in flight */
+    auto work_pipeline = sycl_pipeline<unsigned>(8);
     auto q = sycl::queue{};
+    int data_fd = open("/dev/urandom", O_RDONLY);
+    if (data_fd < 0) { /* Every job would fail its read otherwise */
+        std::cerr << "Cannot open /dev/urandom: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
 
     /* Launching 20 parallel jobs on q */
-    for (auto i : range(0, 20)) {
-        work_pipeline.emplace_back(sycl_task_flow_example(i, q));
-        if (auto result = advance_pipeline(work_pipeline)) {
-            std::cout << "Result: " << *result << ", pipeline depth" << work_pipeline.size() << std::endl; /* Process the result, some heavy computation */
+    for (auto i : range(0U, 20U)) {
+        while (!work_pipeline.launch([&]() { return sycl_task_flow_example(i, q, data_fd); })) {
+            if (auto result = work_pipeline.poll()) { /* Only the jobs whose event completed move forward */
+                std::cout << "Result: " << *result << ", pipeline depth" << work_pipeline.in_flight() << std::endl; /* Process the result, some heavy computation */
+            }
         }
     }
 
     /* Flushing remaining work */
-    while (!work_pipeline.empty()) {
-        if (auto result = advance_pipeline(work_pipeline)) {
-            std::cout << "Result: " << *result << ", pipeline depth" << work_pipeline.size() << std::endl; /* Process the result, some heavy computation */
-        }
+    while (auto result = work_pipeline.next()) {
+        std::cout << "Result: " << *result << ", pipeline depth" << work_pipeline.in_flight() << std::endl; /* Process the result, some heavy computation */
     }
+    close(data_fd);
 }
 
@@ -0,0 +1,78 @@
+#include "helpers.hpp"
+#include <coro>
+
+
+CORO_ARENA_FRAMES_BEGIN
+single_task<int, false, false, arena_frames> arena_answer(std::allocator_arg_t, frame_arena &, int value) {
+    co_await std::suspend_always{};
+    co_return value;
+}
+
+single_task<int, false, false, arena_frames> pool_answer(int value) {
+    co_return value;
+}
+
+struct walker {
+    int offset;
+
+    single_task<int, false, false, arena_frames> walk(std::allocator_arg_t, frame_arena &, int value) const {
+        co_return value + offset;
+    }
+};
+CORO_ARENA_FRAMES_END
+
+
+TEST(frame_arena, frames_are_contiguous) {
+    auto arena = frame_arena(4096);
+    auto first = arena_answer(std::allocator_arg, arena, 1);
+    auto after_first = arena.used();
+    auto second = arena_answer(std::allocator_arg, arena, 2);
+    ASSERT_EQ(arena.live_frames(), 2);
+    ASSERT_EQ(arena.used(), 2 * after_first);
+
+    auto *first_frame = static_cast<std::byte *>(std::coroutine_handle<>(first).address());
+    auto *second_frame = static_cast<std::byte *>(std::coroutine_handle<>(second).address());
+    ASSERT_EQ(second_frame - first_frame, static_cast<ptrdiff_t>(after_first));
+
+    first();
+    second();
+    ASSERT_EQ(*first(), 1);
+    ASSERT_EQ(*second(), 2);
+}
+
+TEST(frame_arena, rewinds_when_empty) {
+    auto arena = frame_arena(4096);
+    {
+        auto task = arena_answer(std::allocator_arg, arena, 1);
+        ASSERT_GT(arena.used(), 0);
+    }
+    ASSERT_EQ(arena.live_frames(), 0);
+    ASSERT_EQ(arena.used(), 0);
+}
+
+TEST(frame_arena, member_coroutine) {
+    auto arena = frame_arena(4096);
+    auto w = walker{10};
+    auto task = w.walk(std::allocator_arg, arena, 1);
+    ASSERT_EQ(arena.live_frames(), 1);
+    ASSERT_EQ(*task(), 11);
+}
+
+TEST(frame_arena, falls_back_to_pool_without_arena) {
+    auto task = pool_answer(3);
+    ASSERT_EQ(*task(), 3);
+}
+
+TEST(frame_arena, exhausted) {
+    auto arena = frame_arena(16);
+    ASSERT_THROW(arena_answer(std::allocator_arg, arena, 1), std::bad_alloc);
+    ASSERT_EQ(arena.live_frames(), 0);
+}
+
+TEST(frame_arena, huge_pages) {
+    auto arena = frame_arena(4096, true);
+    ASSERT_EQ(arena.capacity() % frame_arena::huge_page_size, 0);
+    auto task = arena_answer(std::allocator_arg, arena, 4);
+    task();
+    ASSERT_EQ(*task(), 4);
+}
@@ -0,0 +1,194 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static async_generator<int> counter(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+static single_task<int, false, true> square(int i) {
+    co_return i * i;
+}
+
+/* Awaits a task between its values */
+static async_generator<int> squares(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield co_await square(i);
+    }
+}
+
+static async_generator<int> fails_after(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("Producer failed");
+}
+
+static async_generator<int> slow_stream(int id, const bool *events, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        co_await wait_for(flag_event{&events[i]});
+        co_yield id * 100 + static_cast<int>(i);
+    }
+}
+
+static single_task<int> consume_stream(int id, const bool *events, size_t count, std::vector<int> &order) {
+    auto gen = slow_stream(id, events, count);
+    while (auto value = co_await gen.next()) {
+        order.push_back(*value);
+    }
+    co_return id;
+}
+
+
+TEST(async_generator, next_until_exhausted) {
+    auto sum_all = []() -> single_task<int, true, true> {
+        auto gen = counter(10);
+        int sum = 0;
+        while (auto value = co_await gen.next()) {
+            sum += *value;
+        }
+        EXPECT_TRUE(gen.done());
+        EXPECT_FALSE(co_await gen.next());
+        co_return sum;
+    };
+    ASSERT_EQ(sync_wait(sum_all()), 45);
+}
+
+TEST(async_generator, iterator_loop) {
+    auto collect = []() -> single_task<std::vector<int>, true, true> {
+        std::vector<int> out;
+        auto gen = squares(5);
+        for (auto it = co_await gen.begin(); it != gen.end(); co_await ++it) {
+            out.push_back(*it);
+        }
+        co_return out;
+    };
+    ASSERT_EQ(sync_wait(collect()), (std::vector<int>{0, 1, 4, 9, 16}));
+}
+
+TEST(async_generator, is_lazy) {
+    bool started = false;
+    auto body = [&]() -> async_generator<int> {
+        started = true;
+        co_yield 1;
+    };
+    auto gen = body();
+    ASSERT_FALSE(started);
+    auto first = [&]() -> single_task<int, true, true> { co_return *co_await gen.next(); };
+    ASSERT_EQ(sync_wait(first()), 1);
+    ASSERT_TRUE(started);
+}
+
+TEST(async_generator, moves_values_out) {
+    auto boxes = []() -> async_generator<std::unique_ptr<std::string>> {
+        co_yield std::make_unique<std::string>("a");
+        co_yield std::make_unique<std::string>("b");
+    };
+    auto concat = [&]() -> single_task<std::string, true, true> {
+        auto gen = boxes();
+        std::string out;
+        while (auto box = co_await gen.next()) {
+            out += **box;
+        }
+        co_return out;
+    };
+    ASSERT_EQ(sync_wait(concat()), "ab");
+}
+
+TEST(async_generator, yields_by_reference) {
+    auto names = []() -> async_generator<const std::string &> {
+        std::string name = "first";
+        co_yield name;
+        name = "second";
+        co_yield name;
+    };
+    auto concat = [&]() -> single_task<std::string, true, true> {
+        auto gen = names();
+        std::string out;
+        while (const std::string *name = co_await gen.next()) {
+            out += *name;
+        }
+        co_return out;
+    };
+    ASSERT_EQ(sync_wait(concat()), "firstsecond");
+}
+
+TEST(async_generator, exceptions_propagation) {
+    int seen = 0;
+    auto consume = [&]() -> single_task<void, true, true> {
+        auto gen = fails_after(3);
+        while (auto value = co_await gen.next()) {
+            ++seen;
+        }
+    };
+    ASSERT_THROW(sync_wait(consume()), std::runtime_error);
+    ASSERT_EQ(seen, 3);
+}
+
+TEST(async_generator, producer_moves_to_a_pool) {
+    auto pool = thread_pool(2);
+    auto on_pool = [&]() -> async_generator<std::thread::id> {
+        co_await pool.schedule();
+        for (int i = 0; i < 3; ++i) {
+            co_yield std::this_thread::get_id();
+        }
+    };
+    auto consume = [&]() -> single_task<int, true, true> {
+        auto gen = on_pool();
+        int on_workers = 0;
+        while (auto id = co_await gen.next()) {
+            on_workers += *id != std::this_thread::get_id() ? 0 : 1; // The consumer is resumed where the values come from
+        }
+        co_return on_workers;
+    };
+    ASSERT_EQ(sync_wait(consume()), 3);
+}
+
+TEST(async_generator, one_thread_multiplexes_slow_streams) {
+    constexpr int stream_count = 3;
+    constexpr size_t values = 4;
+    bool events[stream_count][values] = {};
+    std::vector<int> order;
+    auto pipeline = event_pipeline<single_task<int>, delivery::completion_order>(stream_count);
+    for (int id = 0; id < stream_count; ++id) {
+        ASSERT_TRUE(pipeline.launch([&, id]() { return consume_stream(id, events[id], values, order); }));
+    }
+    ASSERT_TRUE(order.empty());
+
+    /* The streams move on only once their own event completes, in whatever order */
+    for (size_t i = 0; i < values; ++i) {
+        for (int id = stream_count - 1; id >= 0; --id) {
+            events[id][i] = true;
+            auto finished = pipeline.poll(); // The stream ends right after its last value
+            ASSERT_EQ(finished.has_value(), i + 1 == values);
+            if (finished) {
+                ASSERT_EQ(*finished, id);
+            }
+            ASSERT_EQ(order.back(), id * 100 + static_cast<int>(i));
+            ASSERT_EQ(order.size(), i * stream_count + static_cast<size_t>(stream_count - id));
+        }
+    }
+    ASSERT_TRUE(pipeline.empty());
+}
+
+TEST(async_generator, dropped_while_suspended) {
+    auto alive = std::make_shared<int>(0);
+    auto holds = [](std::shared_ptr<int> p) -> async_generator<int> {
+        co_yield *p;
+        co_yield *p + 1;
+    };
+    {
+        auto gen = holds(alive);
+        auto first = [&]() -> single_task<int, true, true> { co_return *co_await gen.next(); };
+        ASSERT_EQ(sync_wait(first()), 0);
+        ASSERT_EQ(alive.use_count(), 2);
+    }
+    ASSERT_EQ(alive.use_count(), 1);
+}
@@ -0,0 +1,106 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <numeric>
+#include <vector>
+
+
+template<typename T, size_t batch_size = 64, bool propagate_exceptions = true>
+batch_generator<T, batch_size, propagate_exceptions> batch_range(T begin, T end) {
+    for (T i = begin; i < end; ++i) {
+        co_yield i;
+    }
+}
+
+batch_generator<int, 8> batch_chunks(int chunk_count, int chunk_size) {
+    auto chunk = std::vector<int>(static_cast<size_t>(chunk_size));
+    int next = 0;
+    for (int c = 0; c < chunk_count; ++c) {
+        for (int &v: chunk) {
+            v = next++;
+        }
+        co_yield std::span<const int>(chunk);
+        co_yield next++; // Mixed with single values
+    }
+}
+
+batch_generator<int, 8> batch_throwing(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("Done!"s);
+}
+
+
+TEST(batch_generator, batches_are_full_but_the_last) {
+    auto gen = batch_range<int, 64>(0, 150);
+    auto sizes = std::vector<size_t>{};
+    int expected = 0;
+    for (auto batch = gen.next_batch(); !batch.empty(); batch = gen.next_batch()) {
+        sizes.push_back(batch.size());
+        for (int v: batch) {
+            ASSERT_EQ(v, expected++);
+        }
+    }
+    ASSERT_EQ(sizes, (std::vector<size_t>{64, 64, 22}));
+    ASSERT_TRUE(gen.done());
+    ASSERT_TRUE(gen.next_batch().empty());
+}
+
+TEST(batch_generator, exact_multiple_and_empty) {
+    auto gen = batch_range<int, 64>(0, 128);
+    ASSERT_EQ(gen.next_batch().size(), 64);
+    ASSERT_EQ(gen.next_batch().size(), 64);
+    ASSERT_TRUE(gen.next_batch().empty());
+
+    auto empty = batch_range<int, 64>(0, 0);
+    ASSERT_EQ(empty.begin(), empty.end());
+}
+
+TEST(batch_generator, flattening_iterator) {
+    int acc = 0;
+    for (int i: batch_range<int, 16>(0, 1000)) {
+        acc += i;
+    }
+    ASSERT_EQ(acc, 999 * 1000 / 2);
+}
+
+TEST(batch_generator, span_yields) {
+    for (int chunk_size: {1, 5, 8, 20}) {
+        auto gen = batch_chunks(3, chunk_size);
+        int expected = 0;
+        for (auto batch = gen.next_batch(); !batch.empty(); batch = gen.next_batch()) {
+            ASSERT_LE(batch.size(), 8);
+            for (int v: batch) {
+                ASSERT_EQ(v, expected++);
+            }
+        }
+        ASSERT_EQ(expected, 3 * (chunk_size + 1));
+    }
+}
+
+TEST(batch_generator, reductions) {
+    auto sum = batch_range<float, 256>(0, 1000);
+    ASSERT_EQ(batch_sum(sum), 999.f * 1000.f / 2.f);
+
+    auto lowest = batch_range<int, 64>(-70, 1000);
+    ASSERT_EQ(batch_min(lowest), -70);
+
+    auto highest = batch_range<int, 64>(-70, 1000);
+    ASSERT_EQ(batch_max(highest), 999);
+
+    auto empty = batch_range<int, 64>(0, 0);
+    ASSERT_FALSE(batch_max(empty));
+}
+
+TEST(batch_generator, exceptions_propagation) {
+    auto gen = batch_throwing(10);
+    ASSERT_EQ(gen.next_batch().size(), 8);
+    ASSERT_EQ(gen.next_batch().size(), 2); // Yielded before the throw
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(gen.next_batch();, "Done!");
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(gen.next_batch();, "Called coroutine on empty/destroyed handle");
+}
+
+TEST(batch_generator, static_tests) {
+    static_tests_batch_generator();
+}
@@ -0,0 +1,156 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+static single_task<int> sum_received(channel<int> &ch, int *received) {
+    int sum = 0;
+    while (auto value = co_await ch.recv()) {
+        sum += *value;
+        ++*received;
+    }
+    co_return sum;
+}
+
+static single_task<int> send_all(channel<int> &ch, int count, bool close) {
+    int sent = 0;
+    for (int i = 1; i <= count; ++i) {
+        sent += co_await ch.send(i);
+    }
+    if (close) ch.close();
+    co_return sent;
+}
+
+static single_task<void, false> produce(channel<int> &ch, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        co_await ch.send(i);
+    }
+}
+
+static single_task<void, false> consume(channel<int> &ch, std::vector<std::atomic<int>> &seen) {
+    while (auto value = co_await ch.recv()) {
+        seen[static_cast<size_t>(*value)]++;
+    }
+}
+
+static single_task<int> pipelined_recv(channel<int> &ch) {
+    auto value = co_await ch.recv();
+    co_return value ? *value : -1;
+}
+
+
+TEST(channel, try_send_and_recv) {
+    auto ch = channel<int>(3);
+    ASSERT_EQ(ch.capacity(), 4);
+    ASSERT_EQ(channel<int>(0).capacity(), 2);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ch.try_send(i));
+    }
+    int extra = 4;
+    ASSERT_FALSE(ch.try_send(extra));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(ch.try_recv(), i);
+    }
+    ASSERT_FALSE(ch.try_recv());
+}
+
+TEST(channel, receiver_waits_for_sender) {
+    auto ch = channel<int>(2);
+    int received = 0;
+    auto consumer = sum_received(ch, &received);
+    ASSERT_FALSE(consumer.get()); // Suspended on the empty channel
+    auto producer = send_all(ch, 100, true); // Resumes the consumer in place at each send
+    ASSERT_EQ(producer.get(), 100);
+    ASSERT_EQ(received, 100);
+    ASSERT_EQ(consumer.get(), 5050);
+}
+
+TEST(channel, sender_waits_for_room) {
+    auto ch = channel<int>(2);
+    auto producer = send_all(ch, 10, true);
+    ASSERT_FALSE(producer.get()); // Suspended on the third value
+    int received = 0;
+    auto consumer = sum_received(ch, &received);
+    ASSERT_EQ(producer.get(), 10);
+    ASSERT_EQ(consumer.get(), 55);
+    ASSERT_EQ(received, 10);
+}
+
+TEST(channel, close) {
+    auto ch = channel<int>(4);
+    int received[2] = {};
+    auto first = sum_received(ch, &received[0]);
+    auto second = sum_received(ch, &received[1]);
+    ch.close(); // Both waiting receivers end
+    ASSERT_EQ(first.get(), 0);
+    ASSERT_EQ(second.get(), 0);
+    auto producer = send_all(ch, 3, false);
+    ASSERT_EQ(producer.get(), 0);
+    int value = 1;
+    ASSERT_FALSE(ch.try_send(value));
+    ASSERT_TRUE(ch.closed());
+}
+
+TEST(channel, close_drains_first) {
+    auto ch = channel<int>(4);
+    auto producer = send_all(ch, 6, false);
+    ASSERT_FALSE(producer.get()); // 2 values waiting for room
+    ch.close(); // The waiting senders fail
+    ASSERT_EQ(producer.get(), 4);
+    int received = 0;
+    auto consumer = sum_received(ch, &received);
+    ASSERT_EQ(consumer.get(), 1 + 2 + 3 + 4);
+}
+
+TEST(channel, move_only_values) {
+    auto ch = channel<std::unique_ptr<int>>(4);
+    auto value = std::make_unique<int>(7);
+    ASSERT_TRUE(ch.try_send(value));
+    ASSERT_FALSE(value);
+    ASSERT_EQ(**ch.try_recv(), 7);
+    value = std::make_unique<int>(8);
+    ASSERT_TRUE(ch.try_send(value)); // Left in the channel, destroyed with it
+}
+
+TEST(channel, waits_in_event_pipeline) {
+    auto ch = channel<int>(2);
+    auto pipeline = event_pipeline<single_task<int>, delivery::completion_order>(3);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pipeline.launch([&]() { return pipelined_recv(ch); }));
+    }
+    ASSERT_FALSE(pipeline.poll());
+    int value = 42;
+    ASSERT_TRUE(ch.try_send(value)); // Completes a waiter, the pipeline resumes it
+    ASSERT_EQ(pipeline.poll(), 42);
+    ASSERT_EQ(pipeline.in_flight(), 2);
+    ch.close();
+    ASSERT_EQ(pipeline.next(), -1);
+    ASSERT_EQ(pipeline.next(), -1);
+    ASSERT_TRUE(pipeline.empty());
+}
+
+TEST(channel, producers_and_consumers_on_threads) {
+    constexpr int producer_count = 4, consumer_count = 3, per_producer = 20'000;
+    for (size_t capacity: {2, 64}) {
+        auto ch = channel<int>(capacity);
+        std::vector<std::atomic<int>> seen(producer_count * per_producer);
+        std::vector<std::thread> consumers;
+        for (int i = 0; i < consumer_count; ++i) {
+            consumers.emplace_back([&]() { sync_wait(consume(ch, seen)); });
+        }
+        std::vector<std::thread> producers;
+        for (int i = 0; i < producer_count; ++i) {
+            producers.emplace_back([&, i]() { sync_wait(produce(ch, i * per_producer, per_producer)); });
+        }
+        for (auto &producer: producers) producer.join();
+        ch.close();
+        for (auto &consumer: consumers) consumer.join();
+        for (auto &count: seen) {
+            ASSERT_EQ(count.load(), 1) << capacity;
+        }
+    }
+}
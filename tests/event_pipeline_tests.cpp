@@ -0,0 +1,106 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+
+template<bool start_immediately>
+single_task<int, start_immediately> two_stages(int id, const bool *first, const bool *second, int *resumes) {
+    co_await wait_for(flag_event{first});
+    ++*resumes;
+    co_await wait_for(flag_event{second});
+    ++*resumes;
+    co_return id;
+}
+
+single_task<int, true, true> delayed(int id, std::chrono::milliseconds delay) {
+    co_await wait_for(timer_event(delay));
+    co_await wait_for(thread_event([]() { std::this_thread::sleep_for(1ms); }));
+    if (id < 0) throw std::runtime_error("Negative id");
+    co_return id;
+}
+
+
+TEST(event_pipeline, resumes_only_completed_events) {
+    bool events[2][2] = {};
+    int resumes[2] = {};
+    auto pipeline = event_pipeline<single_task<int>, delivery::completion_order>(2);
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_TRUE(pipeline.launch([&, i]() { return two_stages<true>(i, &events[i][0], &events[i][1], &resumes[i]); }));
+    }
+    ASSERT_TRUE(pipeline.full());
+    ASSERT_FALSE(pipeline.launch([&]() { return two_stages<true>(2, &events[0][0], &events[0][1], &resumes[0]); }));
+
+    ASSERT_FALSE(pipeline.poll());
+    ASSERT_EQ(resumes[0] + resumes[1], 0);
+
+    events[1][0] = true;
+    ASSERT_FALSE(pipeline.poll());
+    ASSERT_EQ(resumes[0], 0);
+    ASSERT_EQ(resumes[1], 1);
+
+    events[1][1] = true;
+    ASSERT_EQ(pipeline.poll(), 1); // Completion order: the second task overtakes the first one
+    ASSERT_EQ(pipeline.in_flight(), 1);
+
+    events[0][0] = events[0][1] = true;
+    ASSERT_EQ(pipeline.next(), 0);
+    ASSERT_TRUE(pipeline.empty());
+    ASSERT_FALSE(pipeline.next());
+}
+
+TEST(event_pipeline, in_order_delivery) {
+    bool events[2][2] = {};
+    int resumes[2] = {};
+    auto pipeline = event_pipeline<single_task<int, false>>(4);
+    for (int i = 0; i < 2; ++i) {
+        pipeline.launch([&, i]() { return two_stages<false>(i, &events[i][0], &events[i][1], &resumes[i]); });
+    }
+    events[1][0] = events[1][1] = true;
+    ASSERT_FALSE(pipeline.poll());
+    ASSERT_FALSE(pipeline.poll()); // Done, but held back behind the first task
+    ASSERT_EQ(pipeline.in_flight(), 2);
+    events[0][0] = events[0][1] = true;
+    ASSERT_EQ(pipeline.next(), 0);
+    ASSERT_EQ(pipeline.next(), 1);
+}
+
+TEST(event_pipeline, cpu_events_and_depth_cap) {
+    auto pipeline = event_pipeline<single_task<int, true, true>, delivery::completion_order>(4);
+    auto results = std::vector<int>{};
+    for (int i = 0; i < 12; ++i) {
+        while (!pipeline.launch([&]() { return delayed(i, std::chrono::milliseconds(12 - i)); })) {
+            ASSERT_LE(pipeline.in_flight(), 4);
+            if (auto result = pipeline.poll()) results.push_back(*result);
+        }
+    }
+    while (auto result = pipeline.next()) {
+        results.push_back(*result);
+    }
+    std::sort(results.begin(), results.end());
+    ASSERT_EQ(results.size(), 12);
+    for (int i = 0; i < 12; ++i) {
+        ASSERT_EQ(results[static_cast<size_t>(i)], i);
+    }
+}
+
+TEST(event_pipeline, exceptions_propagation) {
+    auto pipeline = event_pipeline<single_task<int, true, true>>(2);
+    pipeline.launch([]() { return delayed(-1, 1ms); });
+    pipeline.launch([]() { return delayed(1, 1ms); });
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(pipeline.next();, "Negative id");
+    ASSERT_EQ(pipeline.next(), 1);
+}
+
+TEST(event_pipeline, outside_of_a_pipeline) {
+    auto task = delayed(3, 1ms); // Waits in place
+    ASSERT_EQ(task.get(), 3);
+}
+
+TEST(event_pipeline, static_tests) {
+    static_tests_event_pipeline();
+}
@@ -0,0 +1,83 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <string>
+
+
+enum class parse_error : uint8_t {
+    empty, not_a_digit
+};
+
+single_task<expected<int, parse_error>> parse(std::string s) {
+    if (s.empty()) co_return unexpected(parse_error::empty);
+    int value = 0;
+    for (char c: s) {
+        if (c < '0' || c > '9') co_return unexpected(parse_error::not_a_digit);
+        value = value * 10 + (c - '0');
+    }
+    co_return value;
+}
+
+single_task<expected<int, parse_error>> sum_of(std::string a, std::string b) {
+    auto lhs = co_await parse(std::move(a));
+    if (!lhs) co_return unexpected(lhs.error());
+    auto rhs = co_await parse(std::move(b));
+    if (!rhs) co_return unexpected(rhs.error());
+    co_return *lhs + *rhs;
+}
+
+single_task<expected<void, parse_error>, false> check(bool ok) {
+    co_await std::suspend_always{};
+    if (!ok) co_return unexpected(parse_error::empty);
+    co_return {};
+}
+
+generator<expected<int, parse_error>, false> parse_all(std::vector<std::string> inputs) {
+    for (auto &s: inputs) {
+        auto result = *parse(s).get();
+        co_yield result;
+        if (!result) co_return; // The error ends the sequence
+    }
+}
+
+
+TEST(expected, single_task_value_and_error) {
+    auto ok = parse("1234");
+    ASSERT_TRUE(ok.get()->has_value());
+    ASSERT_EQ(ok.get()->value(), 1234);
+
+    auto failed = parse("12a4");
+    ASSERT_FALSE(failed.get()->has_value());
+    ASSERT_EQ(failed.get()->error(), parse_error::not_a_digit);
+}
+
+TEST(expected, awaited_errors) {
+    ASSERT_EQ(**sum_of("40", "2").get(), 42);
+    ASSERT_EQ(sum_of("40", "").get()->error(), parse_error::empty);
+    ASSERT_EQ(sync_wait(sum_of("x", "2")).error(), parse_error::not_a_digit);
+}
+
+TEST(expected, void_results) {
+    auto ok = check(true);
+    ASSERT_FALSE(ok.resume());
+    ASSERT_TRUE(ok.resume()->has_value());
+
+    auto failed = check(false);
+    failed.resume();
+    ASSERT_EQ(failed.resume()->error(), parse_error::empty);
+}
+
+TEST(expected, generator_stops_on_error) {
+    int values = 0;
+    bool failed = false;
+    for (const auto &result: parse_all({"1", "2", "", "3"})) {
+        if (result) ++values;
+        else failed = result.error() == parse_error::empty;
+    }
+    ASSERT_EQ(values, 2);
+    ASSERT_TRUE(failed);
+}
+
+TEST(expected, static_tests) {
+    static_tests_expected();
+}
@@ -0,0 +1,70 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <numeric>
+
+
+template<typename frame_policy>
+single_task<int, false, false, frame_policy> answer() {
+    co_return 42;
+}
+
+template<typename frame_policy>
+generator<int, true, frame_policy> count_to(int n) {
+    for (int i = 0; i < n; ++i) {
+        co_yield i;
+    }
+}
+
+
+TEST(frame_pool, single_task_frames_are_recycled) {
+    void *first_frame;
+    {
+        auto task = answer<pooled_frames>();
+        first_frame = std::coroutine_handle<>(task).address();
+        ASSERT_EQ(*task(), 42);
+    }
+    auto task = answer<pooled_frames>();
+    ASSERT_EQ(std::coroutine_handle<>(task).address(), first_frame);
+    ASSERT_EQ(*task(), 42);
+}
+
+TEST(frame_pool, generator_frames_are_recycled) {
+    void *first_frame;
+    {
+        auto gen = count_to<pooled_frames>(10);
+        first_frame = std::coroutine_handle<>(gen).address();
+        ASSERT_EQ(std::accumulate(gen.begin(), gen.end(), 0), 45);
+    }
+    auto gen = count_to<pooled_frames>(10);
+    ASSERT_EQ(std::coroutine_handle<>(gen).address(), first_frame);
+    ASSERT_EQ(std::accumulate(gen.begin(), gen.end(), 0), 45);
+}
+
+TEST(frame_pool, heap_frames_bypass_the_pool) {
+    frame_pool::local().release();
+    {
+        auto task = answer<heap_frames>();
+        ASSERT_EQ(*task(), 42);
+    }
+    for (size_t size = 1; size <= frame_pool::max_pooled_size; size += frame_pool::granularity) {
+        ASSERT_EQ(frame_pool::local().cached(size), 0);
+    }
+}
+
+TEST(frame_pool, size_classes) {
+    auto &pool = frame_pool::local();
+    pool.release();
+    void *small = pool.allocate(1);
+    pool.deallocate(small, 1);
+    ASSERT_EQ(pool.cached(frame_pool::granularity), 1);
+    ASSERT_EQ(pool.cached(frame_pool::granularity + 1), 0);
+    ASSERT_EQ(pool.allocate(frame_pool::granularity), small); // Same size class
+    pool.deallocate(small, frame_pool::granularity);
+
+    void *large = pool.allocate(frame_pool::max_pooled_size + 1);
+    pool.deallocate(large, frame_pool::max_pooled_size + 1);
+    ASSERT_EQ(pool.cached(frame_pool::max_pooled_size + 1), 0);
+    pool.release();
+    ASSERT_EQ(pool.cached(1), 0);
+}
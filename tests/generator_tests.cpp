@@ -2,7 +2,9 @@
 #include <coro>
 
 
+#include <memory>
 #include <numeric>
+#include <vector>
 
 template<typename T, bool propagate_exceptions>
 generator<T, propagate_exceptions> range_this(T begin, T end, T step = 1) {
@@ -44,7 +46,7 @@ TEST(range_this, exceptions_propagation_enabled_iterator) {
 }
 
 TEST(range_this, exceptions_propagation_disabled) {
-    auto gen = ranrange_thisge<int, false>(1, 10, 0);
+    auto gen = range_this<int, false>(1, 10, 0);
     EXPECT_NO_THROW(gen(););
     ASSERT_TRUE(gen.done());
     ASSERT_FALSE(gen());
@@ -80,6 +82,163 @@ TEST(range, empty_range) {
 }
 
 
+template<bool propagate_exceptions>
+recursive_generator<int, propagate_exceptions> nested_range(int depth) {
+    if (depth < 0) throw std::runtime_error("Negative depth"s);
+    co_yield depth;
+    if (depth > 0) {
+        co_yield elements_of(nested_range<propagate_exceptions>(depth - 1));
+    }
+    co_yield -depth;
+}
+
+recursive_generator<int> nested_with_empty_and_lvalue() {
+    co_yield elements_of(recursive_generator<int>{}); // Empty handle
+    auto child = nested_range<true>(0);
+    co_yield elements_of(child);
+    co_yield 1;
+}
+
+recursive_generator<int> after_exhausted(recursive_generator<int> &child) {
+    co_yield elements_of(child); // Already at its final suspend point
+    co_yield 7;
+}
+
+recursive_generator<int, true> nested_throwing(int depth) {
+    co_yield depth;
+    co_yield elements_of(nested_range<true>(-1));
+    co_yield 42; // Never reached
+}
+
+
+TEST(recursive_generator, elements_of) {
+    auto values = std::vector<int>{};
+    for (auto i: nested_range<true>(3)) {
+        values.push_back(i);
+    }
+    ASSERT_EQ(values, (std::vector<int>{3, 2, 1, 0, 0, -1, -2, -3}));
+}
+
+TEST(recursive_generator, elements_of_exhausted_child) {
+    auto child = nested_range<true>(1);
+    for ([[maybe_unused]] auto i: child) {}
+    auto values = std::vector<int>{};
+    for (auto i: after_exhausted(child)) {
+        values.push_back(i);
+    }
+    ASSERT_EQ(values, std::vector<int>{7});
+}
+
+TEST(recursive_generator, resume_interface) {
+    auto gen = nested_range<false>(1);
+    ASSERT_EQ(gen(), 1);
+    ASSERT_EQ(gen(), 0);
+    ASSERT_EQ(gen.get(), 0);
+    ASSERT_EQ(gen(), 0);
+    ASSERT_EQ(gen(), -1);
+    ASSERT_FALSE(gen());
+    ASSERT_TRUE(gen.done());
+}
+
+TEST(recursive_generator, empty_and_lvalue_children) {
+    auto gen = nested_with_empty_and_lvalue();
+    ASSERT_EQ(std::accumulate(gen.begin(), gen.end(), 0), 1);
+}
+
+TEST(recursive_generator, exception_from_child) {
+    auto gen = nested_throwing(5);
+    auto it = gen.begin();
+    ASSERT_EQ(*it, 5);
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(++it;, "Negative depth");
+}
+
+TEST(recursive_generator, early_destruction) {
+    auto gen = nested_range<true>(10);
+    for (int i = 0; i < 5; ++i) gen();
+    ASSERT_EQ(gen.get(), 6);
+    gen.destroy(); // Destroys the nested frames too
+}
+
+
+struct tracked {
+    int value;
+    const tracked *self = this;
+};
+
+template<bool propagate_exceptions>
+generator<const tracked &, propagate_exceptions> tracked_range(int end) {
+    tracked current{0};
+    for (; current.value < end; ++current.value) {
+        co_yield current;
+    }
+    co_yield tracked{-1}; // The temporary lives until the generator is resumed
+}
+
+generator<int &> counters(int &last_seen) {
+    int counter = 0;
+    while (true) {
+        co_yield counter;
+        last_seen = counter;
+    }
+}
+
+
+TEST(reference_generator, iterator_reads_in_place) {
+    int expected = 0;
+    for (const tracked &t: tracked_range<true>(3)) {
+        ASSERT_EQ(t.self, &t); // Never copied
+        ASSERT_EQ(t.value, expected < 3 ? expected : -1);
+        ++expected;
+    }
+    ASSERT_EQ(expected, 4);
+}
+
+TEST(reference_generator, get_returns_pointer) {
+    auto gen = tracked_range<false>(2);
+    const tracked *first = gen();
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first->value, 0);
+    ASSERT_EQ(gen.get(), first);
+    ASSERT_EQ(gen(), first); // Same object in the frame, updated
+    ASSERT_EQ(first->value, 1);
+    ASSERT_EQ(gen()->value, -1);
+    ASSERT_EQ(gen(), nullptr);
+    ASSERT_TRUE(gen.done());
+}
+
+TEST(reference_generator, mutable_reference) {
+    int last_seen = -1;
+    auto gen = counters(last_seen);
+    *gen() = 41;
+    gen();
+    ASSERT_EQ(last_seen, 41);
+}
+
+
+generator<std::unique_ptr<int>> owned_values(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield std::make_unique<int>(i);
+    }
+}
+
+
+TEST(move_only_generator, take_and_iterate) {
+    auto gen = owned_values(3);
+    ASSERT_EQ(**gen(), 0); // Pointer to the yielded value
+    auto first = gen.take();
+    ASSERT_EQ(**first, 0);
+    gen();
+    auto second = gen.take();
+    ASSERT_EQ(**second, 1);
+
+    int acc = 0;
+    for (const auto &p: owned_values(4)) {
+        acc += *p;
+    }
+    ASSERT_EQ(acc, 6);
+}
+
+
 TEST(generator, static_tests) {
     static_tests_coroutine_generator();
 }
\ No newline at end of file
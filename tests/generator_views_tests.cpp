@@ -0,0 +1,78 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <algorithm>
+#include <ranges>
+#include <string>
+#include <vector>
+
+
+template<bool propagate_exceptions>
+generator<int, propagate_exceptions> counting(int end, int *resume_count = nullptr) {
+    for (int i = 0; i < end; ++i) {
+        if (resume_count) ++*resume_count;
+        co_yield i;
+    }
+}
+
+generator<int> counting_then_throw(int end) {
+    for (int i = 0; i < end; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("Done!"s);
+}
+
+
+TEST(generator_ranges, standard_views) {
+    auto values = std::vector<int>{};
+    std::ranges::copy(counting<true>(100) | std::views::filter([](int i) { return i % 7 == 0; }) | std::views::take(4), std::back_inserter(values));
+    ASSERT_EQ(values, (std::vector<int>{0, 7, 14, 21}));
+    ASSERT_TRUE(std::ranges::equal(counting<false>(5), std::views::iota(0, 5)));
+}
+
+TEST(fused_views, transform_filter_take) {
+    auto values = std::vector<std::string>{};
+    for (const auto &s: counting<true>(100)
+                        | fused::transform([](int i) { return i * i; })
+                        | fused::filter([](int i) { return i % 2 == 1; })
+                        | fused::transform([](int i) { return std::to_string(i); })
+                        | fused::take(3)) {
+        values.push_back(s);
+    }
+    ASSERT_EQ(values, (std::vector<std::string>{"1", "9", "25"}));
+}
+
+TEST(fused_views, take_stops_resuming) {
+    int resume_count = 0;
+    auto gen = counting<true>(100, &resume_count);
+    int acc = 0;
+    for (int i: gen | fused::take(10)) {
+        acc += i;
+    }
+    ASSERT_EQ(acc, 45);
+    ASSERT_EQ(resume_count, 10);
+    ASSERT_FALSE(gen.done()); // The lvalue source is only referenced
+}
+
+TEST(fused_views, transform_called_once_per_element) {
+    int calls = 0;
+    auto view = counting<false>(10) | fused::transform([&](int i) { ++calls; return i + 1; }) | fused::filter([](int i) { return i > 5; });
+    ASSERT_TRUE(std::ranges::equal(view, std::views::iota(6, 11)));
+    ASSERT_EQ(calls, 10);
+}
+
+TEST(fused_views, empty_and_exceptions) {
+    auto empty = counting<true>(0) | fused::transform([](int i) { return i; });
+    ASSERT_EQ(empty.begin(), empty.end());
+
+    auto throwing = counting_then_throw(3) | fused::filter([](int) { return true; });
+    auto it = throwing.begin();
+    ASSERT_EQ(*it, 0);
+    ++it;
+    ++it;
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(++it;, "Done!");
+}
+
+TEST(fused_views, static_tests) {
+    static_tests_generator_views();
+}
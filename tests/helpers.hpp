@@ -3,6 +3,13 @@
 #include <gtest/gtest.h>
 #include <stdexcept>
 
+/* Pollable event flipped by hand, to control exactly when each task may move on */
+struct flag_event {
+    const bool *complete;
+
+    [[nodiscard]] bool is_complete() const noexcept { return *complete; }
+};
+
 #define EXPECT_THROW_RUNTIME_ERROR_STREQ(stmt, string) \
     EXPECT_THROW(                                      \
         try{                                           \
@@ -0,0 +1,126 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+
+static std::vector<uint64_t> random_keys(size_t count, uint64_t max, unsigned seed) {
+    std::mt19937_64 engine(seed);
+    std::uniform_int_distribution<uint64_t> distribution(0, max);
+    std::vector<uint64_t> out(count);
+    std::generate(out.begin(), out.end(), [&]() { return distribution(engine); });
+    return out;
+}
+
+static std::vector<uint64_t> sorted_unique_keys(size_t count, uint64_t max, unsigned seed) {
+    auto keys = random_keys(count, max, seed);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+
+TEST(interleaved, lower_bound_matches_std) {
+    for (size_t size: {0UL, 1UL, 2UL, 3UL, 17UL, 1000UL, 4096UL}) {
+        auto sorted = random_keys(size, 500, 1); // With duplicates
+        std::sort(sorted.begin(), sorted.end());
+        auto keys = random_keys(300, 520, 2);
+        auto results = interleaved_lower_bound<8>(sorted, keys);
+        ASSERT_EQ(results, scalar_lower_bound(sorted, keys));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ASSERT_EQ(results[i], static_cast<size_t>(std::lower_bound(sorted.begin(), sorted.end(), keys[i]) - sorted.begin()));
+        }
+    }
+}
+
+TEST(interleaved, lower_bound_custom_comparison) {
+    auto sorted = std::vector<int>{9, 7, 7, 4, 1};
+    auto keys = std::vector<int>{10, 7, 5, 0};
+    auto results = interleaved_lower_bound(sorted, keys, std::greater<>{});
+    ASSERT_EQ(results, (std::vector<size_t>{0, 1, 3, 5}));
+}
+
+TEST(interleaved, keys_from_a_generator) {
+    auto sorted = std::vector<int>{0, 10, 20, 30};
+    auto results = interleaved_lower_bound<2>(sorted, range(0, 40, 5));
+    ASSERT_EQ(results, (std::vector<size_t>{0, 1, 1, 2, 2, 3, 3, 4}));
+}
+
+TEST(interleaved, hash_probe_finds_inserted_keys) {
+    auto inserted = random_keys(5000, 1U << 20, 3);
+    auto table = open_addressing_table<uint64_t, uint64_t>(inserted.size());
+    for (auto key: inserted) {
+        table.insert(key, key * 3);
+    }
+    ASSERT_FALSE(table.insert(inserted.front(), 0));
+    ASSERT_EQ(*table.find(inserted.front()), inserted.front() * 3);
+
+    auto keys = random_keys(3000, 1U << 20, 4);
+    keys.insert(keys.end(), inserted.begin(), inserted.begin() + 1000);
+    auto results = interleaved_hash_probe(table, keys);
+    ASSERT_EQ(results.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(results[i], table.find(keys[i]));
+        bool present = std::find(inserted.begin(), inserted.end(), keys[i]) != inserted.end();
+        ASSERT_EQ(results[i] != nullptr, present);
+        if (present) {
+            ASSERT_EQ(*results[i], keys[i] * 3);
+        }
+    }
+}
+
+TEST(interleaved, hash_table_refuses_to_overfill) {
+    auto table = open_addressing_table<int, int>(2);
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_TRUE(table.insert(i, i));
+    }
+    ASSERT_THROW(table.insert(2, 2), std::length_error);
+}
+
+TEST(interleaved, tree_find_matches_values) {
+    for (size_t size: {0UL, 1UL, 7UL, 8UL, 56UL, 57UL, 1000UL, 20000UL}) {
+        auto keys = sorted_unique_keys(size, 1U << 24, 5);
+        auto values = std::vector<uint32_t>(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            values[i] = static_cast<uint32_t>(i);
+        }
+        auto tree = bplus_tree<uint64_t, uint32_t>(keys, values);
+        ASSERT_EQ(tree.empty(), keys.empty());
+
+        auto lookups = random_keys(500, 1U << 24, 6);
+        lookups.insert(lookups.end(), keys.begin(), keys.begin() + static_cast<ptrdiff_t>(std::min<size_t>(keys.size(), 500)));
+        auto results = interleaved_tree_find<4>(tree, lookups);
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            auto it = std::lower_bound(keys.begin(), keys.end(), lookups[i]);
+            if (it != keys.end() && *it == lookups[i]) {
+                ASSERT_NE(results[i], nullptr);
+                ASSERT_EQ(*results[i], static_cast<uint32_t>(it - keys.begin()));
+            } else {
+                ASSERT_EQ(results[i], nullptr);
+            }
+            ASSERT_EQ(results[i], tree.find(lookups[i]));
+        }
+    }
+}
+
+TEST(interleaved, tree_with_small_nodes) {
+    auto keys = std::vector<int>(100);
+    std::iota(keys.begin(), keys.end(), 0);
+    auto tree = bplus_tree<int, int, 2>(keys, keys);
+    ASSERT_EQ(tree.height(), 5); // 50 leaves, 17, 6, 2, 1
+    auto results = interleaved_tree_find(tree, std::vector<int>{-1, 0, 42, 99, 100});
+    ASSERT_EQ(results[0], nullptr);
+    ASSERT_EQ(*results[1], 0);
+    ASSERT_EQ(*results[2], 42);
+    ASSERT_EQ(*results[3], 99);
+    ASSERT_EQ(results[4], nullptr);
+}
+
+TEST(interleaved, tree_rejects_unsorted_keys) {
+    ASSERT_THROW((bplus_tree<int, int>({2, 1}, {0, 0})), std::invalid_argument);
+    ASSERT_THROW((bplus_tree<int, int>({1, 1}, {0, 0})), std::invalid_argument);
+    ASSERT_THROW((bplus_tree<int, int>({1}, {0, 0})), std::invalid_argument);
+}
@@ -0,0 +1,179 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <numeric>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+
+/* A file of `size` bytes, i-th byte being i % 251, removed with the fixture */
+class temp_file {
+public:
+    explicit temp_file(size_t size) {
+        char name[] = "/tmp/coro_io_testXXXXXX";
+        fd_ = mkstemp(name);
+        path_ = name;
+        std::vector<unsigned char> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<unsigned char>(i % 251);
+        }
+        if (size && ::pwrite(fd_, bytes.data(), size, 0) != static_cast<ssize_t>(size)) {
+            throw std::runtime_error("Could not write the test file");
+        }
+    }
+
+    ~temp_file() {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+    int fd_;
+    std::string path_;
+};
+
+static single_task<size_t, true, true> read_block(io_ring &ring, int fd, std::vector<std::byte> &buffer, uint64_t offset) {
+    co_return co_await async_read(ring, fd, buffer, offset);
+}
+
+/* Reads every `stride`-th block of the file, starting from block `first`, and checks the contents */
+static single_task<size_t, true, true> read_blocks(io_ring &ring, int fd, size_t first, size_t stride, size_t block, size_t size) {
+    std::vector<std::byte> buffer(block);
+    size_t total = 0;
+    for (size_t offset = first * block; offset < size; offset += stride * block) {
+        auto bytes = co_await async_read(ring, fd, buffer, offset);
+        for (size_t i = 0; i < bytes; ++i) {
+            if (static_cast<unsigned char>(buffer[i]) != (offset + i) % 251) {
+                throw std::runtime_error("Wrong content");
+            }
+        }
+        total += bytes;
+    }
+    co_return total;
+}
+
+static single_task<void, true, true> write_then_read(io_ring &ring, int fd, std::string text, std::string &out) {
+    auto written = co_await async_write(ring, fd, std::as_bytes(std::span(text)), 3);
+    out.resize(written);
+    auto read = co_await async_read(ring, fd, std::as_writable_bytes(std::span(out)), 3);
+    out.resize(read);
+}
+
+
+class io : public ::testing::TestWithParam<io_backend> {
+};
+
+TEST_P(io, reads_a_block) {
+    auto file = temp_file(1000);
+    auto ring = io_ring(8, GetParam());
+    std::vector<std::byte> buffer(100);
+    auto task = read_block(ring, file.fd(), buffer, 500);
+    ring.run();
+    ASSERT_EQ(*task.get(), 100);
+    ASSERT_EQ(static_cast<unsigned char>(buffer[0]), 500 % 251);
+}
+
+TEST_P(io, short_read_at_the_end) {
+    auto file = temp_file(1000);
+    auto ring = io_ring(8, GetParam());
+    std::vector<std::byte> buffer(100);
+    auto tail = read_block(ring, file.fd(), buffer, 950);
+    ring.run();
+    ASSERT_EQ(*tail.get(), 50);
+    auto past = read_block(ring, file.fd(), buffer, 5000);
+    ring.run();
+    ASSERT_EQ(*past.get(), 0);
+}
+
+TEST_P(io, writes_then_reads_back) {
+    auto file = temp_file(0);
+    auto ring = io_ring(8, GetParam());
+    std::string out;
+    auto task = write_then_read(ring, file.fd(), "hello io", out);
+    ring.run();
+    task.get();
+    ASSERT_EQ(out, "hello io");
+}
+
+TEST_P(io, failures_are_rethrown) {
+    auto ring = io_ring(8, GetParam());
+    std::vector<std::byte> buffer(16);
+    auto task = read_block(ring, -1, buffer, 0);
+    ring.run();
+    try {
+        task.get();
+        FAIL();
+    } catch (const std::system_error &e) {
+        ASSERT_EQ(e.code().value(), EBADF);
+    }
+}
+
+TEST_P(io, many_coroutines_share_the_ring) {
+    constexpr size_t block = 4096, coroutines = 64, size = 5 * coroutines * block + 123;
+    auto file = temp_file(size);
+    auto ring = io_ring(16, GetParam()); // Fewer entries than coroutines: queuing flushes the ring when full
+    std::vector<single_task<size_t, true, true>> readers;
+    for (size_t i = 0; i < coroutines; ++i) {
+        readers.push_back(read_blocks(ring, file.fd(), i, coroutines, block, size));
+    }
+    ring.run();
+    size_t total = 0;
+    for (auto &reader: readers) {
+        total += *reader.get();
+    }
+    ASSERT_EQ(total, size);
+    ASSERT_EQ(ring.in_flight(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(backends, io, ::testing::Values(io_backend::io_uring, io_backend::blocking));
+
+
+TEST(io_ring, batches_submissions) {
+    auto ring = io_ring(64);
+    if (ring.backend() != io_backend::io_uring) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    auto file = temp_file(64 * 512);
+    std::vector<std::vector<std::byte>> buffers(32, std::vector<std::byte>(512));
+    std::vector<single_task<size_t, true, true>> tasks;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        tasks.push_back(read_block(ring, file.fd(), buffers[i], i * 512));
+    }
+    ASSERT_EQ(ring.in_flight(), 32);
+    ASSERT_EQ(ring.enter_calls(), 0); // Only queued so far
+    ring.run();
+    ASSERT_LE(ring.enter_calls(), 32 / 2);
+    for (auto &task: tasks) {
+        ASSERT_EQ(*task.get(), 512);
+    }
+}
+
+TEST(io_ring, blocking_backend_does_not_suspend) {
+    auto file = temp_file(100);
+    auto ring = io_ring(8, io_backend::blocking);
+    std::vector<std::byte> buffer(10);
+    auto task = read_block(ring, file.fd(), buffer, 0);
+    ASSERT_EQ(*task.get(), 10);
+}
+
+TEST(io_ring, reports_to_an_event_pipeline) {
+    auto file = temp_file(4096);
+    auto &ring = io_ring::local();
+    std::vector<std::vector<std::byte>> buffers(4, std::vector<std::byte>(1024));
+    auto pipeline = event_pipeline<single_task<size_t, true, true>, delivery::in_order>(4);
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        ASSERT_TRUE(pipeline.launch([&, i]() { return read_block(ring, file.fd(), buffers[i], i * 1024); }));
+    }
+    size_t total = 0;
+    while (auto bytes = pipeline.next()) {
+        total += *bytes;
+    }
+    ASSERT_EQ(total, 4096);
+    ASSERT_EQ(ring.in_flight(), 0);
+    ASSERT_EQ(static_cast<unsigned char>(buffers[3][0]), 3072 % 251);
+}
@@ -0,0 +1,150 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+static generator<int> sorted(std::vector<int> values) {
+    std::sort(values.begin(), values.end());
+    for (auto value: values) {
+        co_yield value;
+    }
+}
+
+static generator<int> failing_after(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("source failed");
+}
+
+static generator<std::unique_ptr<int>> boxed(std::vector<int> values) {
+    for (auto value: values) {
+        co_yield std::make_unique<int>(value);
+    }
+}
+
+static generator<uint64_t> random_values(size_t count, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    for (size_t i = 0; i < count; ++i) {
+        co_yield rng() % 1000;
+    }
+}
+
+template<typename range_t>
+static auto collect(range_t &&range) {
+    std::vector<std::ranges::range_value_t<range_t>> values;
+    for (auto &&value: range) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+
+TEST(merge, any_number_of_sources) {
+    std::mt19937 rng(42);
+    for (size_t k: {0, 1, 2, 3, 5, 8, 13, 64}) {
+        std::vector<int> expected;
+        std::vector<generator<int>> sources;
+        for (size_t i = 0; i < k; ++i) {
+            std::vector<int> values(rng() % 20); // Some empty
+            for (auto &value: values) {
+                value = static_cast<int>(rng() % 100);
+            }
+            expected.insert(expected.end(), values.begin(), values.end());
+            sources.push_back(sorted(std::move(values)));
+        }
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(collect(merge(std::span(sources))), expected) << k;
+    }
+}
+
+TEST(merge, owns_moved_sources) {
+    std::vector<generator<int>> sources;
+    sources.push_back(sorted({5, 1, 9}));
+    sources.push_back(sorted({2, 8}));
+    auto merged = merge(std::move(sources));
+    ASSERT_EQ(collect(merged), std::vector<int>({1, 2, 5, 8, 9}));
+}
+
+TEST(merge, comparator) {
+    std::vector<std::vector<int>> sources = {{9, 4, 1}, {8, 7, 2}, {}, {6}};
+    ASSERT_EQ(collect(merge(std::span(sources), std::greater<>{})), std::vector<int>({9, 8, 7, 6, 4, 2, 1}));
+}
+
+TEST(merge, moves_values_out) {
+    std::vector<generator<std::unique_ptr<int>>> sources;
+    sources.push_back(boxed({1, 4}));
+    sources.push_back(boxed({2, 3}));
+    std::vector<int> values;
+    for (auto &&value: merge(std::span(sources), [](auto &a, auto &b) { return *a < *b; })) {
+        values.push_back(*value);
+    }
+    ASSERT_EQ(values, std::vector<int>({1, 2, 3, 4}));
+}
+
+TEST(merge, rethrows_source_exceptions) {
+    std::vector<generator<int>> sources;
+    sources.push_back(sorted({0, 1, 2, 3, 4, 5}));
+    sources.push_back(failing_after(3));
+    std::vector<int> values;
+    ASSERT_THROW(for (auto value: merge(std::span(sources))) values.push_back(value), std::runtime_error);
+    ASSERT_EQ(values, std::vector<int>({0, 0, 1, 1, 2}));
+}
+
+TEST(external_sort, in_memory) {
+    ASSERT_EQ(collect(external_sort(random_values(1000, 1), 1 << 20)), collect(external_sort(random_values(1000, 1), 1000 * sizeof(uint64_t))));
+    ASSERT_TRUE(std::ranges::is_sorted(collect(external_sort(random_values(1000, 1), 1 << 20))));
+    ASSERT_TRUE(collect(external_sort(std::vector<int>(), 64)).empty());
+}
+
+TEST(external_sort, spills_runs) {
+    for (size_t budget: {sizeof(uint64_t), size_t{64}, size_t{1000}, size_t{4096}}) {
+        auto expected = collect(random_values(10'000, 7));
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(collect(external_sort(random_values(10'000, 7), budget)), expected) << budget;
+    }
+}
+
+TEST(external_sort, comparator_and_directory) {
+    auto dir = std::filesystem::temp_directory_path() / "coro_external_sort_test";
+    std::filesystem::create_directories(dir);
+    auto expected = collect(random_values(5000, 3));
+    std::sort(expected.begin(), expected.end(), std::greater<>{});
+    ASSERT_EQ(collect(external_sort(random_values(5000, 3), 512, std::greater<>{}, dir)), expected);
+    ASSERT_TRUE(std::filesystem::is_empty(dir)); // Runs are anonymous
+    std::filesystem::remove(dir);
+}
+
+TEST(external_sort, missing_directory) {
+    ASSERT_THROW(for (auto value: external_sort(random_values(100, 1), 64, std::less<>{}, "/nonexistent/dir")) (void) value, std::system_error);
+}
+
+TEST(external_sort, cascades_runs) {
+    /* 4000 runs of 4 values: two levels of intermediate merges */
+    auto expected = collect(random_values(16'000, 9));
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(collect(external_sort(random_values(16'000, 9), 4 * sizeof(uint64_t))), expected);
+}
+
+TEST(external_sort, bounds_open_runs) {
+    /* 127 * 128 + 127 runs of a single value: left as is, two full levels would be merged at the end */
+    auto open_files = []() { return std::distance(std::filesystem::directory_iterator("/proc/self/fd"), {}); };
+    auto before = open_files();
+    auto sorted = external_sort(random_values(127 * 128 + 127, 5), sizeof(uint64_t));
+    auto it = sorted.begin();
+    ASSERT_LE(open_files() - before, static_cast<std::ptrdiff_t>(merge_detail::max_fan_in));
+    auto values = std::vector<uint64_t>{*it};
+    for (++it; it != sorted.end(); ++it) {
+        values.push_back(*it);
+    }
+    ASSERT_TRUE(std::ranges::is_sorted(values));
+    ASSERT_EQ(values.size(), 127 * 128 + 127);
+}
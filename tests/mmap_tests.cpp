@@ -0,0 +1,109 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/* Removed with the fixture */
+class temp_path {
+public:
+    explicit temp_path(const std::string &contents) {
+        char name[] = "/tmp/coro_mmap_testXXXXXX";
+        close(mkstemp(name));
+        path_ = name;
+        std::ofstream(path_, std::ios::binary) << contents;
+    }
+
+    ~temp_path() { unlink(path_.c_str()); }
+
+    [[nodiscard]] const std::string &path() const noexcept { return path_; }
+
+private:
+    std::string path_;
+};
+
+static std::vector<std::string> getline_lines(const std::string &contents, char delimiter = '\n') {
+    std::vector<std::string> lines;
+    std::istringstream in(contents);
+    for (std::string line; std::getline(in, line, delimiter);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static std::vector<std::string> mapped_lines(const std::string &path, char delimiter = '\n') {
+    std::vector<std::string> lines;
+    for (auto line: mmap_lines(path, delimiter)) {
+        lines.emplace_back(line);
+    }
+    return lines;
+}
+
+
+TEST(mmap, lines_like_getline) {
+    for (const std::string contents: {"", "\n", "a", "a\n", "a\nb", "\n\nx\n\n", "crlf\r\nline\r\n", "no newline at the end"}) {
+        auto file = temp_path(contents);
+        ASSERT_EQ(mapped_lines(file.path()), getline_lines(contents)) << contents;
+    }
+}
+
+TEST(mmap, lines_across_blocks) {
+    std::mt19937 rng(42);
+    for (size_t size = 0; size < 600; size += 7) {
+        std::string contents;
+        for (size_t i = 0; i < size; ++i) {
+            contents += rng() % 8 == 0 ? '\n' : static_cast<char>('a' + rng() % 26);
+        }
+        auto file = temp_path(contents);
+        ASSERT_EQ(mapped_lines(file.path()), getline_lines(contents)) << size;
+    }
+}
+
+TEST(mmap, long_lines) {
+    auto contents = std::string(1000, 'x') + "\n" + std::string(63, 'y') + "\n" + std::string(64, 'z') + "\n" + std::string(65, 'w');
+    auto file = temp_path(contents);
+    ASSERT_EQ(mapped_lines(file.path()), getline_lines(contents));
+}
+
+TEST(mmap, custom_delimiter) {
+    auto file = temp_path("a,b,,c\nd,");
+    ASSERT_EQ(mapped_lines(file.path(), ','), (std::vector<std::string>{"a", "b", "", "c\nd"}));
+}
+
+TEST(mmap, views_outlive_the_next_line) {
+    auto file = temp_path("first\nsecond\n");
+    auto lines = mmap_lines(file.path());
+    std::vector<std::string_view> views;
+    for (auto line: lines) {
+        views.push_back(line);
+    }
+    ASSERT_EQ(views, (std::vector<std::string_view>{"first", "second"}));
+    ASSERT_EQ(views[0].data() + 6, views[1].data()); // Both point into the mapping
+}
+
+TEST(mmap, missing_file) {
+    ASSERT_THROW(mmap_lines("/nonexistent/coro_mmap_test"), std::system_error);
+}
+
+TEST(mmap, records) {
+    auto file = temp_path("0123456789");
+    std::vector<std::string> records;
+    for (auto record: mmap_records(file.path(), 4)) {
+        records.emplace_back(reinterpret_cast<const char *>(record.data()), record.size());
+    }
+    ASSERT_EQ(records, (std::vector<std::string>{"0123", "4567", "89"}));
+    ASSERT_THROW(mmap_records(file.path(), 0), std::invalid_argument);
+}
+
+TEST(mmap, empty_file_records) {
+    auto file = temp_path("");
+    size_t count = 0;
+    for (auto record: mmap_records(file.path(), 8)) {
+        count += record.size();
+    }
+    ASSERT_EQ(count, 0);
+}
@@ -0,0 +1,101 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+static generator<int> numbers(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+static generator<int> fails_after(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("Producer failed");
+}
+
+static generator<std::unique_ptr<int>> boxed(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield std::make_unique<int>(i);
+    }
+}
+
+
+TEST(parallel, for_each_visits_every_value_once) {
+    auto pool = thread_pool(3);
+    constexpr int count = 20000;
+    auto visits = std::vector<std::atomic<int>>(count);
+    parallel_for_each(numbers(count), pool, [&](int i) { visits[static_cast<size_t>(i)].fetch_add(1, std::memory_order_relaxed); });
+    for (auto &visit: visits) {
+        ASSERT_EQ(visit.load(), 1);
+    }
+}
+
+TEST(parallel, for_each_spreads_expensive_work) {
+    auto pool = thread_pool(3);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    parallel_for_each(numbers(64), pool, [&](int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    ASSERT_GT(threads.size(), 1);
+}
+
+TEST(parallel, reduce_matches_serial) {
+    auto pool = thread_pool(2);
+    constexpr int64_t count = 100000;
+    auto sum = parallel_reduce(numbers(count), pool, int64_t{0}, std::plus<>{});
+    ASSERT_EQ(sum, count * (count - 1) / 2);
+    ASSERT_EQ(parallel_reduce(numbers(0), pool, int64_t{42}, std::plus<>{}), 42);
+}
+
+TEST(parallel, reduce_moves_values_out_of_the_generator) {
+    auto pool = thread_pool(2);
+    auto sum = parallel_reduce(boxed(1000), pool, std::make_unique<int>(0), [](std::unique_ptr<int> a, std::unique_ptr<int> b) {
+        *a += *b;
+        return a;
+    });
+    ASSERT_EQ(*sum, 999 * 1000 / 2);
+}
+
+TEST(parallel, other_ranges_are_copied) {
+    auto pool = thread_pool(2);
+    auto values = std::vector<int>(5000);
+    std::iota(values.begin(), values.end(), 1);
+    ASSERT_EQ(parallel_reduce(values, pool, 0L, std::plus<>{}), 5000L * 5001 / 2);
+    ASSERT_EQ(values.back(), 5000);
+}
+
+TEST(parallel, exceptions_are_rethrown) {
+    auto pool = thread_pool(2);
+    std::atomic<int> seen{0};
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(parallel_for_each(fails_after(1000), pool, [&](int) { seen.fetch_add(1); });, "Producer failed");
+    ASSERT_EQ(seen.load(), 1000);
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(parallel_for_each(numbers(1000), pool, [&](int i) {
+        if (i == 500) throw std::runtime_error("Consumer failed");
+    });, "Consumer failed");
+}
+
+TEST(parallel, refuses_to_block_a_worker) {
+    auto pool = thread_pool(1);
+    auto attempt = [](thread_pool &pool) -> single_task<bool, false> {
+        co_await pool.schedule();
+        try {
+            parallel_for_each(numbers(10), pool, [](int) {});
+        } catch (std::logic_error &) {
+            co_return true;
+        }
+        co_return false;
+    };
+    ASSERT_TRUE(sync_wait(attempt(pool)));
+}
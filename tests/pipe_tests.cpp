@@ -0,0 +1,173 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static generator<int> numbers(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+static generator<int> counted(int count, std::atomic<int> &produced) {
+    for (int i = 0; i < count; ++i) {
+        produced.fetch_add(1, std::memory_order_relaxed);
+        co_yield i;
+    }
+}
+
+static generator<int> squares(generator<int> source) {
+    for (auto i: source) {
+        co_yield i * i;
+    }
+}
+
+/* Written for a single thread, without exceptions propagation */
+static generator<int, false> evens(generator<int, false> source) {
+    for (auto i: source) {
+        if (i % 2 == 0) co_yield i;
+    }
+}
+
+static generator<std::string> to_strings(generator<int> source) {
+    for (auto i: source) {
+        co_yield std::to_string(i);
+    }
+}
+
+static generator<int> fails_at(generator<int> source, int failing) {
+    for (auto i: source) {
+        if (i == failing) throw std::runtime_error("Stage failed");
+        co_yield i;
+    }
+}
+
+
+TEST(pipe, keeps_the_order_through_the_stages) {
+    std::vector<int> out;
+    for (auto i: pipe(numbers(10000), [](generator<int> in) { return squares(std::move(in)); })) {
+        out.push_back(i);
+    }
+    ASSERT_EQ(out.size(), 10000);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(out[static_cast<size_t>(i)], i * i);
+    }
+}
+
+TEST(pipe, runs_each_stage_on_its_own_thread) {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto record = [&]() {
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    };
+    auto stage = [&](generator<int> in) -> generator<int> {
+        for (auto i: in) {
+            record();
+            co_yield i;
+        }
+    };
+    int count = 0;
+    for (auto i: pipe(numbers(100), stage, stage)) {
+        ASSERT_EQ(i, count++);
+    }
+    ASSERT_EQ(count, 100);
+    ASSERT_EQ(threads.size(), 2);
+    ASSERT_FALSE(threads.contains(std::this_thread::get_id()));
+}
+
+TEST(pipe, mixes_value_types_and_moves_them) {
+    std::vector<std::string> out;
+    auto lengths = [](generator<std::string> in) -> generator<std::unique_ptr<size_t>> {
+        for (auto &&s: in) {
+            co_yield std::make_unique<size_t>(s.size());
+        }
+    };
+    auto unbox = [](generator<std::unique_ptr<size_t>> in) -> generator<std::string> {
+        for (auto it = in.begin(); it != in.end(); ++it) {
+            co_yield std::string(**in.take(), 'x');
+        }
+    };
+    for (auto &&s: pipe<4>(numbers(1000), [](generator<int> in) { return to_strings(std::move(in)); }, lengths, unbox)) {
+        out.push_back(s);
+    }
+    ASSERT_EQ(out.size(), 1000);
+    ASSERT_EQ(out[5], "x");
+    ASSERT_EQ(out[999], "xxx");
+}
+
+TEST(pipe, takes_stages_without_exceptions_propagation) {
+    int sum = 0;
+    for (auto i: pipe(numbers(100), [](generator<int, false> in) { return evens(std::move(in)); })) {
+        sum += i;
+    }
+    ASSERT_EQ(sum, 2450);
+}
+
+TEST(pipe, bounds_how_far_the_source_runs_ahead) {
+    std::atomic<int> produced{0};
+    auto piped = pipe<8>(counted(1000, produced));
+    auto it = piped.begin();
+    ASSERT_EQ(*it, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    /* The ring, the value being pushed and the one the drain holds */
+    ASSERT_LE(produced.load(), 8 + 2);
+    ASSERT_GE(produced.load(), 8);
+}
+
+TEST(pipe, stops_the_stages_when_dropped_early) {
+    std::atomic<int> produced{0};
+    {
+        auto piped = pipe<16>(counted(1 << 30, produced), [](generator<int> in) { return squares(std::move(in)); });
+        int seen = 0;
+        for (auto i: piped) {
+            (void) i;
+            if (++seen == 100) break;
+        }
+    }
+    ASSERT_LT(produced.load(), 1000);
+}
+
+TEST(pipe, rethrows_the_failure_of_a_stage) {
+    int seen = 0;
+    auto run = [&]() {
+        for (auto i: pipe(numbers(1000), [](generator<int> in) { return fails_at(std::move(in), 500); }, [](generator<int> in) { return squares(std::move(in)); })) {
+            ASSERT_EQ(i, seen * seen);
+            ++seen;
+        }
+    };
+    ASSERT_THROW(run(), std::runtime_error);
+    ASSERT_EQ(seen, 500);
+}
+
+TEST(pipe, rethrows_past_a_stage_without_exceptions_propagation) {
+    auto run = []() {
+        int sum = 0;
+        for (auto i: pipe(numbers(1000), [](generator<int> in) { return fails_at(std::move(in), 10); }, [](generator<int, false> in) { return evens(std::move(in)); })) {
+            sum += i;
+        }
+        return sum;
+    };
+    ASSERT_THROW(run(), std::runtime_error);
+}
+
+TEST(pipe, rethrows_the_failure_of_the_source) {
+    auto failing = []() -> generator<int> {
+        co_yield 1;
+        throw std::runtime_error("Source failed");
+    };
+    std::vector<int> out;
+    auto run = [&]() {
+        for (auto i: pipe(failing(), [](generator<int> in) { return squares(std::move(in)); })) {
+            out.push_back(i);
+        }
+    };
+    ASSERT_THROW(run(), std::runtime_error);
+    ASSERT_EQ(out, std::vector<int>{1});
+}
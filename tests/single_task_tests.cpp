@@ -1,6 +1,10 @@
 #include <coro>
 #include "helpers.hpp"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 
 template<bool start_immediately, bool propagate_exceptions>
 single_task<int, start_immediately, propagate_exceptions> state_machine(int steps) {
@@ -56,6 +60,160 @@ TEST(state_machine, immediate_start_throw_begining_no_propagate) {
 }
 
 
+template<bool start_immediately>
+single_task<int, start_immediately> add_one(single_task<int, start_immediately> inner) {
+    co_return co_await inner + 1;
+}
+
+single_task<int, false> count_down(int depth) {
+    if (depth == 0) co_return 0;
+    co_return co_await count_down(depth - 1) + 1;
+}
+
+single_task<void, false, true> throwing_leaf() {
+    co_await std::suspend_always{};
+    throw std::runtime_error("Leaf failed");
+}
+
+single_task<int, false, true> awaits_throwing_leaf() {
+    co_await throwing_leaf();
+    co_return 1;
+}
+
+
+TEST(await, lazy_task) {
+    auto task = add_one<false>(add_one<false>(state_machine<false, false>(2)));
+    ASSERT_FALSE(task());
+    ASSERT_FALSE(task()); // The leaf suspends on its own, resuming the root resumes it
+    ASSERT_EQ(task(), 4);
+}
+
+TEST(await, immediate_task) {
+    auto task = add_one<true>(state_machine<true, false>(0)); // Already done when awaited
+    ASSERT_TRUE(task.get());
+    ASSERT_EQ(*task.get(), 1);
+}
+
+TEST(await, immediate_suspended_task) {
+    auto task = add_one<true>(state_machine<true, false>(3));
+    int counter = 0;
+    for (auto res = task(); !res.has_value(); counter++, res = task());
+    ASSERT_EQ(counter, 1); // One step runs at the creation, one when awaited, the last resume completes both tasks
+    ASSERT_EQ(*task.get(), 4);
+}
+
+TEST(await, deep_chain) {
+    auto task = count_down(10'000);
+    ASSERT_EQ(task(), 10'000);
+}
+
+TEST(await, exception_propagation) {
+    auto task = awaits_throwing_leaf();
+    ASSERT_FALSE(task());
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(task();, "Leaf failed");
+}
+
+
+/* Neither default constructible nor copyable, counts the live instances */
+struct resource {
+    explicit resource(int v) : value(std::make_unique<int>(v)) { ++live; }
+
+    resource(resource &&other) noexcept: value(std::move(other.value)) { ++live; }
+
+    resource &operator=(resource &&) = default;
+
+    ~resource() { --live; }
+
+    std::unique_ptr<int> value;
+    static inline int live = 0;
+};
+
+template<bool propagate_exceptions>
+single_task<resource, false, propagate_exceptions> make_resource(int v) {
+    co_return resource(v);
+}
+
+single_task<std::string> failing_text() {
+    throw std::runtime_error("Swallowed");
+    co_return "never";
+}
+
+single_task<resource> failing_resource() {
+    throw std::runtime_error("Swallowed");
+    co_return resource(0);
+}
+
+single_task<std::string> awaits_failing_text() {
+    auto text = co_await failing_text();
+    co_return text + "!";
+}
+
+single_task<resource> forward_resource(int v) {
+    auto r = co_await make_resource<false>(v); // Moved out of the temporary task
+    *r.value += 1;
+    co_return std::move(r);
+}
+
+
+TEST(move_only_result, take_moves_out_once) {
+    {
+        auto task = make_resource<true>(41);
+        ASSERT_FALSE(task.take());
+        task.resume();
+        ASSERT_EQ(*task.get()->value, 41); // Pointer to the result, not a copy
+        auto r = task.take();
+        ASSERT_TRUE(r);
+        ASSERT_EQ(*r->value, 41);
+        EXPECT_THROW_RUNTIME_ERROR_STREQ(task.take();, "Called coroutine on empty/destroyed handle");
+    }
+    ASSERT_EQ(resource::live, 0);
+}
+
+TEST(move_only_result, awaited_and_temporary_tasks) {
+    {
+        auto r = forward_resource(1).get(); // get() on a temporary moves the result out
+        ASSERT_EQ(*r->value, 2);
+        ASSERT_EQ(*sync_wait(forward_resource(5)).value, 6);
+    }
+    ASSERT_EQ(resource::live, 0);
+}
+
+TEST(move_only_result, destroyed_before_completion) {
+    {
+        auto task = make_resource<true>(1);
+    }
+    ASSERT_EQ(resource::live, 0);
+}
+
+TEST(move_only_result, large_result_not_copied) {
+    const int *data = nullptr;
+    auto make_buffer = [](const int **data) -> single_task<std::vector<int>> {
+        auto buffer = std::vector<int>(1 << 20, 1);
+        *data = buffer.data();
+        co_return std::move(buffer);
+    };
+    auto task = make_buffer(&data);
+    auto buffer = std::move(task).get();
+    ASSERT_EQ(buffer->data(), data);
+    ASSERT_FALSE(task.get()); // Taken
+}
+
+
+/* Without exceptions propagation, a failed task has completed without a result */
+TEST(move_only_result, failed_without_propagation) {
+    auto text = failing_text();
+    ASSERT_FALSE(text.get());
+    ASSERT_FALSE(text.take());
+    ASSERT_EQ(*awaits_failing_text().get(), "!"); // Default constructed when awaited
+    {
+        auto r = failing_resource();
+        ASSERT_EQ(r.get(), nullptr);
+        ASSERT_FALSE(r.take());
+    }
+    ASSERT_EQ(resource::live, 0);
+}
+
+
 TEST(single_task, static_test) {
     static_tests_single_task();
 }
\ No newline at end of file
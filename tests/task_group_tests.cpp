@@ -0,0 +1,119 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <numeric>
+#include <vector>
+
+
+template<bool start_immediately, bool propagate_exceptions>
+single_task<int, start_immediately, propagate_exceptions> sleepy_square(int value, int *resume_count) {
+    if (value < 0) {
+        throw std::runtime_error("Negative value");
+    }
+    for (int i = 0; i < value; ++i) {
+        co_await std::suspend_always{};
+        ++*resume_count;
+    }
+    co_return value * value;
+}
+
+single_task<void, false> sleepy_void(int value, int *resume_count) {
+    for (int i = 0; i < value; ++i) {
+        co_await std::suspend_always{};
+        ++*resume_count;
+    }
+}
+
+
+TEST(task_group, uneven_lengths_are_refilled) {
+    auto lengths = std::vector<int>{0, 5, 1, 7, 0, 3, 2, 9, 4};
+    auto results = std::vector<int>(lengths.size(), -1);
+    int resume_count = 0;
+    auto group = task_group<single_task<int, true, false>, 3>{};
+    group.run(lengths, [&](int value) { return sleepy_square<true, false>(value, &resume_count); },
+              [&](size_t index, int result) {
+                  ASSERT_LE(group.in_flight(), 3);
+                  results[index] = result;
+              });
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        ASSERT_EQ(results[i], lengths[i] * lengths[i]);
+    }
+    ASSERT_EQ(resume_count, std::accumulate(lengths.begin(), lengths.end(), 0)); // Finished tasks are never resumed again
+    ASSERT_EQ(group.in_flight(), 0);
+}
+
+TEST(task_group, lazy_tasks) {
+    auto lengths = std::vector<int>{3, 0, 1};
+    int resume_count = 0;
+    int acc = 0;
+    auto group = task_group<single_task<int, false, false>, 8>{};
+    group.run(lengths.begin(), lengths.end(), [&](int value) { return sleepy_square<false, false>(value, &resume_count); },
+              [&](size_t, int result) { acc += result; });
+    ASSERT_EQ(acc, 10);
+    ASSERT_EQ(resume_count, 4);
+}
+
+TEST(task_group, void_tasks) {
+    auto lengths = std::vector<int>{3, 2, 1, 4};
+    auto finished = std::vector<bool>(lengths.size(), false);
+    int resume_count = 0;
+    auto group = task_group<single_task<void, false>, 2>{};
+    group.run(lengths, [&](int value) { return sleepy_void(value, &resume_count); }, [&](size_t index) { finished[index] = true; });
+    ASSERT_EQ(finished, std::vector<bool>(lengths.size(), true));
+    ASSERT_EQ(resume_count, 10);
+}
+
+TEST(task_group, exceptions_propagation) {
+    auto lengths = std::vector<int>{3, 2, -1, 4};
+    int resume_count = 0;
+    auto group = task_group<single_task<int, true, true>, 2>{};
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(
+            group.run(lengths, [&](int value) { return sleepy_square<true, true>(value, &resume_count); }, [&](size_t, int) {});,
+            "Negative value");
+}
+
+TEST(task_group, set_width) {
+    auto lengths = std::vector<int>(20, 3);
+    int resume_count = 0;
+    auto group = task_group<single_task<int, true, false>, 16>{};
+    group.set_width(4);
+    ASSERT_EQ(group.width(), 4);
+    group.run(lengths, [&](int value) { return sleepy_square<true, false>(value, &resume_count); },
+              [&](size_t, int) { ASSERT_LE(group.in_flight(), 4); });
+    ASSERT_EQ(resume_count, 60);
+
+    group.set_width(100);
+    ASSERT_EQ(group.width(), 16);
+}
+
+TEST(width_tuner, converges_to_the_best_width) {
+    auto tuner = width_tuner(4, 32);
+    auto throughput_at = [](size_t width) { return 100.0 - std::abs(static_cast<double>(width) - 13.0); }; // Peaks at 13
+    for (int sample = 0; sample < 100 && !tuner.converged(); ++sample) {
+        tuner.on_sample(throughput_at(tuner.width()));
+    }
+    ASSERT_TRUE(tuner.converged());
+    ASSERT_NEAR(static_cast<double>(tuner.width()), 13.0, 1.0);
+}
+
+TEST(width_tuner, stays_in_bounds) {
+    auto tuner = width_tuner(32, 32);
+    for (int sample = 0; sample < 100 && !tuner.converged(); ++sample) {
+        ASSERT_GE(tuner.width(), 1);
+        ASSERT_LE(tuner.width(), 32);
+        tuner.on_sample(static_cast<double>(tuner.width())); // The wider the better
+    }
+    ASSERT_EQ(tuner.width(), 32);
+}
+
+TEST(task_group, auto_tune) {
+    auto lengths = std::vector<int>(2000, 20);
+    int resume_count = 0;
+    auto group = task_group<single_task<int, true, false>, 32>{};
+    group.set_width(2);
+    group.auto_tune(256);
+    group.run(lengths, [&](int value) { return sleepy_square<true, false>(value, &resume_count); }, [&](size_t, int) {});
+    ASSERT_EQ(resume_count, 40000);
+    ASSERT_GE(group.width(), 1);
+    ASSERT_LE(group.width(), 32);
+}
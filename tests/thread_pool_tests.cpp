@@ -0,0 +1,164 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <vector>
+
+
+static single_task<uint64_t> parallel_fib(thread_pool &pool, int n) {
+    co_await pool.schedule();
+    if (n < 2) co_return static_cast<uint64_t>(n);
+    auto a = parallel_fib(pool, n - 1); // Forked: queued on the worker's deque
+    auto b = parallel_fib(pool, n - 2);
+    auto fib_b = co_await b;
+    co_return co_await a + fib_b;
+}
+
+static single_task<int, false, true> throw_on_pool(thread_pool &pool) {
+    co_await pool.schedule();
+    throw std::runtime_error("Failed on the pool");
+}
+
+static single_task<std::thread::id, false> thread_after_schedule(thread_pool &pool) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id();
+}
+
+static single_task<int, false> inline_task() {
+    co_return 7;
+}
+
+template<bool start_immediately>
+static single_task<int, start_immediately> hop_then_wait(thread_pool &pool, std::atomic<bool> &go) {
+    co_await pool.schedule();
+    while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    co_return 1;
+}
+
+static single_task<int, false> hop(thread_pool &pool) {
+    co_await pool.schedule();
+    co_return 1;
+}
+
+static single_task<int, false> middle_of_chain(thread_pool &pool) {
+    int value = co_await hop(pool);
+    co_await std::suspend_always{};
+    co_return value + 1;
+}
+
+static single_task<int, false> chain_over_pool_hop(thread_pool &pool) {
+    int value = co_await middle_of_chain(pool);
+    co_await std::suspend_always{};
+    co_return value + 1;
+}
+
+/* An eager child moves to the pool before being awaited, a lazy one once linked in the chain */
+template<bool eager_child>
+static single_task<int, false> chain_with_pool_hop(thread_pool &pool, std::atomic<bool> &go) {
+    int value = co_await hop_then_wait<eager_child>(pool, go);
+    co_await std::suspend_always{};
+    co_return value + 1;
+}
+
+
+TEST(work_stealing_deque, owner_is_lifo_thieves_are_fifo) {
+    auto deque = work_stealing_deque(2);
+    std::vector<char> frames(10);
+    for (auto &frame: frames) {
+        deque.push(std::coroutine_handle<>::from_address(&frame)); // Grows past the initial capacity
+    }
+    ASSERT_EQ(deque.pop().address(), &frames[9]);
+    ASSERT_EQ(deque.steal().address(), &frames[0]);
+    ASSERT_EQ(deque.steal().address(), &frames[1]);
+    for (size_t i = 8; i >= 2; --i) {
+        ASSERT_EQ(deque.pop().address(), &frames[i]);
+    }
+    ASSERT_FALSE(deque.pop());
+    ASSERT_FALSE(deque.steal());
+    ASSERT_TRUE(deque.empty());
+}
+
+TEST(work_stealing_deque, concurrent_steals) {
+    constexpr size_t item_count = 100'000;
+    auto deque = work_stealing_deque();
+    std::vector<char> frames(item_count);
+    std::vector<std::atomic<int>> seen(item_count);
+    std::atomic<bool> done{false};
+    auto consume = [&](std::coroutine_handle<> handle) { seen[static_cast<size_t>(static_cast<char *>(handle.address()) - frames.data())]++; };
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&]() {
+            while (!done.load()) {
+                if (auto handle = deque.steal()) consume(handle);
+            }
+            while (auto handle = deque.steal()) consume(handle);
+        });
+    }
+    for (size_t i = 0; i < item_count; ++i) {
+        deque.push(std::coroutine_handle<>::from_address(&frames[i]));
+        if (i % 3 == 0) {
+            if (auto handle = deque.pop()) consume(handle);
+        }
+    }
+    while (auto handle = deque.pop()) consume(handle);
+    done = true;
+    for (auto &thief: thieves) thief.join();
+    for (auto &count: seen) {
+        ASSERT_EQ(count.load(), 1);
+    }
+}
+
+TEST(thread_pool, schedule_moves_to_a_worker) {
+    auto pool = thread_pool(2);
+    ASSERT_NE(sync_wait(thread_after_schedule(pool)), std::this_thread::get_id());
+    ASSERT_FALSE(pool.on_worker());
+}
+
+TEST(thread_pool, fork_join) {
+    auto pool = thread_pool(4);
+    ASSERT_EQ(sync_wait(parallel_fib(pool, 20)), 6765);
+}
+
+TEST(thread_pool, exception_propagation) {
+    auto pool = thread_pool(2);
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(sync_wait(throw_on_pool(pool));, "Failed on the pool");
+}
+
+template<bool eager_child>
+static void check_chain_hopping_to_the_pool() {
+    auto pool = thread_pool(2);
+    std::atomic<bool> go{false};
+    auto task = chain_with_pool_hop<eager_child>(pool, go);
+    ASSERT_FALSE(task.resume()); // The child moves to the pool
+    ASSERT_FALSE(task.resume()); // The chain belongs to the pool, nothing to resume
+    go.store(true, std::memory_order_release);
+    std::optional<int> result;
+    while (!(result = task.resume())) {} // Nothing runs until the child completes and hands the chain back
+    ASSERT_EQ(*result, 2);
+}
+
+TEST(thread_pool, chain_hopping_to_the_pool) {
+    check_chain_hopping_to_the_pool<true>();
+    check_chain_hopping_to_the_pool<false>();
+}
+
+/* The chain is only ever resumed by the loop, the pool hands it back */
+TEST(thread_pool, chain_driven_while_on_the_pool) {
+    auto pool = thread_pool(2);
+    for (int i = 0; i < 1000; ++i) {
+        auto task = chain_over_pool_hop(pool);
+        std::optional<int> result;
+        while (!(result = task.resume())) {}
+        ASSERT_EQ(*result, 3);
+    }
+}
+
+TEST(sync_wait, inline_task) {
+    auto task = inline_task();
+    ASSERT_EQ(sync_wait(task), 7);
+}
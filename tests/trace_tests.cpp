@@ -0,0 +1,164 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <algorithm>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+template<bool start_immediately>
+static single_task<int, start_immediately, true, pooled_frames, traced> traced_steps(int steps) {
+    for (int i = 0; i < steps; ++i) {
+        co_await std::suspend_always{};
+    }
+    co_return steps;
+}
+
+static single_task<int, true, true, pooled_frames, traced> traced_parent() {
+    auto child = traced_steps<false>(1);
+    co_return co_await child + co_await traced_steps<true>(0);
+}
+
+static single_task<int, false, true, pooled_frames, traced> traced_throw() {
+    co_await std::suspend_always{};
+    throw std::runtime_error("Traced failure");
+}
+
+static generator<int, true, pooled_frames, false, traced> traced_iota(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+CORO_ARENA_FRAMES_BEGIN
+static single_task<int, false, false, arena_frames, traced> traced_in_arena(std::allocator_arg_t, frame_arena &, int value) {
+    co_return value;
+}
+CORO_ARENA_FRAMES_END
+
+static single_task<std::thread::id, false, false, pooled_frames, traced> traced_on_pool(thread_pool &pool) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id();
+}
+
+static std::vector<trace_event::kind_t> kinds_of(const void *frame) {
+    std::vector<trace_event::kind_t> kinds;
+    for (auto &event: trace_log::local_events()) {
+        if (event.frame == frame) kinds.push_back(event.kind);
+    }
+    return kinds;
+}
+
+static size_t count(const std::string &haystack, const std::string &needle) {
+    size_t n = 0;
+    for (auto pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+
+TEST(trace, task_lifecycle_is_recorded) {
+    trace_log::clear();
+    auto task = traced_steps<false>(2);
+    const void *frame = static_cast<std::coroutine_handle<>>(task).address();
+    while (!task.resume()) {}
+    ASSERT_EQ(*task.get(), 2);
+    task.destroy();
+    using e = trace_event;
+    ASSERT_EQ(kinds_of(frame), (std::vector<e::kind_t>{e::create, e::suspend, e::resume, e::suspend, e::resume, e::suspend, e::resume, e::complete, e::destroy}));
+    ASSERT_GE(trace_log::local_events().front().frame_size, sizeof(single_task<int, false, true, pooled_frames, traced>::promise_type));
+}
+
+TEST(trace, started_immediately_runs_from_creation) {
+    trace_log::clear();
+    auto task = traced_steps<true>(1);
+    const void *frame = static_cast<std::coroutine_handle<>>(task).address();
+    task.resume();
+    task.destroy();
+    using e = trace_event;
+    ASSERT_EQ(kinds_of(frame), (std::vector<e::kind_t>{e::create, e::suspend, e::resume, e::complete, e::destroy}));
+}
+
+TEST(trace, untraced_records_nothing) {
+    trace_log::clear();
+    auto task = [](int value) -> single_task<int, false> {
+        co_await std::suspend_always{};
+        co_return value;
+    }(3);
+    while (!task.resume()) {}
+    ASSERT_EQ(*task.get(), 3);
+    ASSERT_TRUE(trace_log::local_events().empty());
+}
+
+TEST(trace, awaited_tasks_and_exceptions) {
+    trace_log::clear();
+    auto parent = traced_parent();
+    while (!parent.resume()) {}
+    ASSERT_EQ(*parent.get(), 1);
+
+    auto failing = traced_throw();
+    failing.resume();
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(failing.resume();, "Traced failure");
+    auto events = trace_log::local_events();
+    auto creates = std::count_if(events.begin(), events.end(), [](auto &event) { return event.kind == trace_event::create; });
+    auto destroys = std::count_if(events.begin(), events.end(), [](auto &event) { return event.kind == trace_event::destroy; });
+    ASSERT_EQ(creates, 4);
+    ASSERT_EQ(destroys, 3); // The parent is still alive
+}
+
+TEST(trace, generator_yields_are_suspensions) {
+    trace_log::clear();
+    int sum = 0;
+    for (auto i: traced_iota(3)) {
+        sum += i;
+    }
+    ASSERT_EQ(sum, 3);
+    using e = trace_event;
+    auto events = trace_log::local_events();
+    ASSERT_EQ(events.size(), 11);
+    ASSERT_EQ(kinds_of(events.front().frame), (std::vector<e::kind_t>{e::create, e::suspend, e::resume, e::suspend, e::resume, e::suspend, e::resume, e::suspend, e::resume, e::complete, e::destroy}));
+}
+
+TEST(trace, allocator_arguments_reach_the_frame_policy) {
+    trace_log::clear();
+    auto arena = frame_arena(4096);
+    auto task = traced_in_arena(std::allocator_arg, arena, 5);
+    ASSERT_EQ(arena.live_frames(), 1);
+    ASSERT_EQ(*task.resume(), 5);
+    task.destroy();
+    ASSERT_EQ(arena.live_frames(), 0);
+    ASSERT_EQ(trace_log::local_events().size(), 5);
+}
+
+TEST(trace, chrome_trace_export) {
+    trace_log::clear();
+    {
+        auto pool = thread_pool(2);
+        auto id = sync_wait(traced_on_pool(pool));
+        ASSERT_NE(id, std::this_thread::get_id());
+    }
+    auto task = traced_steps<false>(2);
+    while (!task.resume()) {}
+    task.destroy();
+
+    std::ostringstream out;
+    trace_log::write_chrome_trace(out);
+    auto json = out.str();
+    ASSERT_EQ(json.rfind(R"({"displayTimeUnit":"ns","traceEvents":[)", 0), 0);
+    ASSERT_EQ(count(json, "{"), count(json, "}"));
+    ASSERT_EQ(count(json, R"("ph":"b")"), 2);
+    ASSERT_EQ(count(json, R"("ph":"e")"), 2);
+    ASSERT_EQ(count(json, R"("name":"completed")"), 2);
+    ASSERT_EQ(count(json, R"("name":"suspended")"), 3 + 2); // The pooled task also suspends to move to a worker
+    std::set<std::string> threads;
+    auto tid = std::regex(R"("tid":([0-9]+))");
+    for (auto it = std::sregex_iterator(json.begin(), json.end(), tid); it != std::sregex_iterator(); ++it) {
+        threads.insert((*it)[1]);
+    }
+    ASSERT_EQ(threads.size(), 2); // Resumed on a worker
+}
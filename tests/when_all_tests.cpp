@@ -0,0 +1,300 @@
+#include "helpers.hpp"
+#include <coro>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+
+static single_task<int, false> lazy_value(int value) {
+    co_return value;
+}
+
+static single_task<void, false> lazy_void(int *counter) {
+    ++*counter;
+    co_return;
+}
+
+static single_task<std::unique_ptr<int>, false> lazy_box(int value) {
+    co_return std::make_unique<int>(value);
+}
+
+static single_task<int, false> steps(int value, int count) {
+    for (int i = 0; i < count; ++i) {
+        co_await std::suspend_always{};
+    }
+    co_return value;
+}
+
+static single_task<int, false, true> on_pool(thread_pool &pool, int value, std::atomic<int> *completed) {
+    co_await pool.schedule();
+    if (value < 0) throw std::runtime_error("Negative value");
+    completed->fetch_add(1);
+    co_return value;
+}
+
+static single_task<int, false> slow_on_pool(thread_pool &pool, int value, std::chrono::microseconds delay) {
+    co_await pool.schedule();
+    std::this_thread::sleep_for(delay);
+    co_return value;
+}
+
+static single_task<int, false> received(channel<int> &ch) {
+    auto value = co_await ch.recv();
+    co_return value ? *value : -1;
+}
+
+static single_task<int, false> after_event(const bool *event, int value) {
+    co_await wait_for(flag_event{event});
+    co_return value;
+}
+
+static single_task<int> sum_after_events(const bool *events) {
+    auto [a, b] = co_await when_all(after_event(&events[0], 1), after_event(&events[1], 2));
+    co_return a + b;
+}
+
+static single_task<int, false> sum_of_steps(int count) {
+    auto [a, b] = co_await when_all(steps(1, count), steps(2, 2 * count));
+    co_return a + b;
+}
+
+static single_task<int, false> nested_sum_of_steps() {
+    auto [a, b] = co_await when_all(sum_of_steps(1), steps(4, 3));
+    co_return a + b;
+}
+
+static single_task<std::tuple<int, std::monostate, int>> all_inline(int *counter) {
+    auto result = co_await when_all(lazy_value(1), lazy_void(counter), lazy_value(3));
+    co_return result;
+}
+
+static single_task<int> sum_of_range(int count) {
+    std::vector<single_task<int, false>> tasks;
+    for (int i = 1; i <= count; ++i) {
+        tasks.push_back(lazy_value(i));
+    }
+    int sum = 0;
+    for (auto value: co_await when_all(std::move(tasks))) {
+        sum += value;
+    }
+    co_return sum;
+}
+
+static single_task<int, false, true> sum_on_pool(thread_pool &pool, int count, std::atomic<int> &completed, int failing = 0) {
+    std::vector<single_task<int, false, true>> tasks;
+    for (int i = 1; i <= count; ++i) {
+        tasks.push_back(on_pool(pool, i == failing ? -i : i, &completed));
+    }
+    int sum = 0;
+    for (auto value: co_await when_all(tasks)) {
+        sum += value;
+    }
+    co_return sum;
+}
+
+static single_task<std::pair<size_t, int>, false> first_of(std::vector<single_task<int, false>> &tasks) {
+    co_return co_await when_any(tasks);
+}
+
+static single_task<std::vector<int>, false> all_of(std::vector<single_task<int, false>> &tasks) {
+    co_return co_await when_all(tasks);
+}
+
+static single_task<std::pair<size_t, int>> first_of_started(channel<int> &ch) {
+    auto done = lazy_value(5);
+    auto waiting = received(ch);
+    done.resume(); // Completed before the group is awaited
+    auto [index, result] = co_await when_any(done, waiting);
+    co_return std::make_pair(index, std::get<0>(result));
+}
+
+static single_task<int> first_after_events(const bool *events) {
+    auto a = after_event(&events[0], 1);
+    auto b = after_event(&events[1], 2);
+    auto [index, result] = co_await when_any(a, b);
+    co_return index == 0 ? std::get<0>(result) : std::get<1>(result);
+}
+
+static single_task<size_t> first_received(channel<int> &a, channel<int> &b, int *value, int *resumes) {
+    auto task_a = received(a);
+    auto task_b = received(b);
+    auto [index, result] = co_await when_any(task_a, task_b);
+    ++*resumes;
+    *value = index == 0 ? std::get<0>(result) : std::get<1>(result);
+    a.close(); // The task left behind completes before the frame goes away
+    b.close();
+    co_return index;
+}
+
+
+TEST(when_all, variadic) {
+    int counter = 0;
+    auto task = all_inline(&counter);
+    ASSERT_TRUE(task.get());
+    ASSERT_EQ(*task.get(), std::make_tuple(1, std::monostate{}, 3));
+    ASSERT_EQ(counter, 1);
+}
+
+TEST(when_all, range) {
+    ASSERT_EQ(*sum_of_range(100).get(), 5050);
+    ASSERT_EQ(*sum_of_range(0).get(), 0);
+}
+
+TEST(when_all, lvalue_tasks_are_read_in_place) {
+    auto copied = lazy_value(4);
+    auto moved = lazy_box(5);
+    auto outer = [&]() -> single_task<int> {
+        auto [a, b] = co_await when_all(copied, moved);
+        co_return a + *b;
+    };
+    auto task = outer();
+    ASSERT_EQ(*task.get(), 9);
+    ASSERT_EQ(*copied.get(), 4); // Copied out, still there
+}
+
+/* Driven by resume(): the awaiting task resumes the tasks of the group, and not the other way around */
+template<typename task_t>
+static auto resume_until_done(task_t &task, int *resumes) {
+    auto result = task.resume();
+    for (; !result; result = task.resume()) {
+        ++*resumes;
+    }
+    return *result;
+}
+
+TEST(when_all, tasks_suspending_in_driven_chain) {
+    int resumes = 0;
+    auto task = sum_of_steps(1);
+    ASSERT_EQ(resume_until_done(task, &resumes), 3);
+    ASSERT_EQ(resumes, 2); // One per step of the longest task
+    resumes = 0;
+    auto longer = sum_of_steps(3);
+    ASSERT_EQ(resume_until_done(longer, &resumes), 3);
+    ASSERT_EQ(resumes, 6);
+    resumes = 0;
+    auto nested = nested_sum_of_steps();
+    ASSERT_EQ(resume_until_done(nested, &resumes), 7);
+    ASSERT_EQ(resumes, 3);
+}
+
+TEST(when_all, detached_in_driven_chain) {
+    auto pool = thread_pool(4);
+    for (int round = 0; round < 20; ++round) {
+        std::atomic<int> completed{0};
+        auto task = sum_on_pool(pool, 50, completed);
+        std::optional<int> result;
+        while (!(result = task.resume())) { // The pool never resumes the awaiting task behind our back
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(*result, 50 * 51 / 2);
+        ASSERT_EQ(completed.load(), 50);
+    }
+}
+
+TEST(when_all, concurrent_on_pool) {
+    auto pool = thread_pool(4);
+    for (int round = 0; round < 20; ++round) {
+        std::atomic<int> completed{0};
+        ASSERT_EQ(sync_wait(sum_on_pool(pool, 200, completed)), 200 * 201 / 2);
+        ASSERT_EQ(completed.load(), 200);
+    }
+}
+
+TEST(when_all, rethrows_after_all_completed) {
+    auto pool = thread_pool(2);
+    std::atomic<int> completed{0};
+    EXPECT_THROW_RUNTIME_ERROR_STREQ(sync_wait(sum_on_pool(pool, 50, completed, 10));, "Negative value");
+    ASSERT_EQ(completed.load(), 49);
+}
+
+TEST(when_all, polled_in_event_pipeline) {
+    bool events[2][2] = {};
+    auto pipeline = event_pipeline<single_task<int>, delivery::completion_order>(2);
+    for (auto &task_events: events) {
+        ASSERT_TRUE(pipeline.launch([&]() { return sum_after_events(task_events); }));
+    }
+    ASSERT_FALSE(pipeline.poll());
+    events[1][1] = true;
+    ASSERT_FALSE(pipeline.poll()); // Half of the group only
+    events[1][0] = true;
+    ASSERT_EQ(pipeline.poll(), 3);
+    events[0][0] = events[0][1] = true;
+    ASSERT_EQ(pipeline.next(), 3);
+    ASSERT_TRUE(pipeline.empty());
+}
+
+TEST(when_any, first_completed) {
+    auto a = channel<int>(2), b = channel<int>(2);
+    int value = 0, resumes = 0;
+    auto task = first_received(a, b, &value, &resumes);
+    ASSERT_FALSE(task.get()); // Both receivers wait
+    int sent = 7;
+    ASSERT_TRUE(b.try_send(sent)); // Completes the second one, which resumes the awaiting task
+    ASSERT_EQ(task.get(), 1);
+    ASSERT_EQ(value, 7);
+    ASSERT_EQ(resumes, 1);
+}
+
+TEST(when_any, already_completed) {
+    std::vector<single_task<int, false>> tasks;
+    tasks.push_back(lazy_value(1));
+    tasks.push_back(lazy_value(2));
+    auto task = first_of(tasks);
+    task.resume();
+    ASSERT_EQ(task.get(), std::make_pair(size_t{0}, 1)); // The first task completes while starting: the second never starts
+    ASSERT_FALSE(tasks[1].get());
+}
+
+TEST(when_any, completed_before_awaiting) {
+    auto ch = channel<int>(2);
+    auto task = first_of_started(ch);
+    ASSERT_EQ(task.get(), std::make_pair(size_t{0}, 5));
+}
+
+TEST(when_any, polled_in_event_pipeline) {
+    bool events[2] = {};
+    auto pipeline = event_pipeline<single_task<int>, delivery::completion_order>(1);
+    ASSERT_TRUE(pipeline.launch([&]() { return first_after_events(events); }));
+    ASSERT_FALSE(pipeline.poll());
+    events[1] = true;
+    ASSERT_EQ(pipeline.poll(), 2);
+    ASSERT_TRUE(pipeline.empty());
+}
+
+TEST(when_any, tasks_suspending_in_driven_chain) {
+    std::vector<single_task<int, false>> tasks;
+    tasks.push_back(steps(0, 2));
+    tasks.push_back(steps(1, 1));
+    int resumes = 0;
+    auto task = first_of(tasks);
+    ASSERT_EQ(resume_until_done(task, &resumes), std::make_pair(size_t{1}, 1));
+    ASSERT_EQ(resumes, 1);
+    ASSERT_EQ(tasks[0].resume(), 0); // Left behind halfway, driven on its own again
+}
+
+TEST(when_any, stragglers_on_pool) {
+    auto pool = thread_pool(4);
+    for (int round = 0; round < 50; ++round) {
+        std::vector<single_task<int, false>> tasks;
+        for (int i = 0; i < 4; ++i) {
+            tasks.push_back(slow_on_pool(pool, i, std::chrono::microseconds(i == round % 4 ? 0 : 200)));
+        }
+        auto [index, value] = sync_wait(first_of(tasks));
+        ASSERT_EQ(static_cast<int>(index), value);
+        ASSERT_EQ(sync_wait(all_of(tasks)), std::vector<int>({0, 1, 2, 3})); // The others went on, and can be awaited again
+    }
+}
+
+TEST(when_any, empty_range) {
+    std::vector<single_task<int, false>> tasks;
+    ASSERT_THROW(auto awaiter = when_any(tasks), std::invalid_argument);
+}